@@ -0,0 +1,95 @@
+#include "apu.h"
+
+#include <stdlib.h>
+
+#define APU_REG_START (0xFF10)
+#define APU_REG_NR52 (0xFF26)
+
+struct apu_s
+{
+    mmu_t *mmu;
+    int enabled;
+};
+
+/* Bits always read as 1, 0xFF10 - 0xFF26. */
+static const uint8_t APU_READ_MASKS[] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF, // NR10 - NR14
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF, // NR20 - NR24
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF, // NR30 - NR34
+    0xFF, 0xFF, 0x00, 0x00, 0xBF, // NR40 - NR44
+    0x00, 0x00, 0x70              // NR50 - NR52
+};
+
+static int apu_read_reg(void *p_context, uint16_t address, uint8_t *data);
+static int apu_write_reg(void *p_context, uint16_t address, uint8_t data);
+
+size_t apu_arena_size(void)
+{
+    return ARENA_SIZE(sizeof(apu_t));
+}
+
+apu_t *apu_allocate(arena_t *p_arena, mmu_t *p_mmu)
+{
+    if (!p_mmu)
+        return NULL;
+
+    apu_t *p_apu = arena_alloc(p_arena, sizeof(apu_t));
+
+    if (p_apu)
+    {
+        p_apu->mmu = p_mmu;
+
+        /* Powered on, as left by the boot ROM. */
+        p_apu->enabled = 1;
+        mmu_io_set(p_mmu, APU_REG_NR52, 0x80);
+
+        for (uint16_t address = APU_REG_START; address <= APU_REG_NR52; address++)
+        {
+            (void)mmu_register_io(p_mmu, address, apu_read_reg, apu_write_reg, p_apu);
+        }
+    }
+
+    return p_apu;
+}
+
+/* Private function definitions */
+
+static int apu_read_reg(void *p_context, uint16_t address, uint8_t *data)
+{
+    apu_t *p_apu = p_context;
+
+    *data = mmu_io_get(p_apu->mmu, address) | APU_READ_MASKS[address - APU_REG_START];
+    return 0;
+}
+
+static int apu_write_reg(void *p_context, uint16_t address, uint8_t data)
+{
+    apu_t *p_apu = p_context;
+
+    if (APU_REG_NR52 == address)
+    {
+        p_apu->enabled = (0 != ((data >> 7) & 0x01));
+
+        if (!p_apu->enabled)
+        {
+            /* Powering off clears all registers. */
+            for (uint16_t reg = APU_REG_START; reg < APU_REG_NR52; reg++)
+            {
+                mmu_io_set(p_apu->mmu, reg, 0);
+            }
+        }
+
+        /* Channel status bits are read only. */
+        mmu_io_set(p_apu->mmu, address, (data & 0x80) | (mmu_io_get(p_apu->mmu, address) & 0x0F));
+        return 0;
+    }
+
+    if (!p_apu->enabled)
+    {
+        /* Registers are read only while powered off. */
+        return 0;
+    }
+
+    mmu_io_set(p_apu->mmu, address, data);
+    return 0;
+}
@@ -1,6 +1,11 @@
 #ifndef APU_H_
 #define APU_H_
 
+#include "../mmu/mmu.h"
+#include "../arena.h"
+
+typedef struct apu_s apu_t;
+
 /* Sound Controller
 Pulse A:
 0xFF10 NR10 Channel 1 Sweep register.
@@ -35,4 +40,8 @@ Noise:
 0xFF30 W    Wave ?
 */
 
+size_t apu_arena_size(void);
+
+apu_t *apu_allocate(arena_t *p_arena, mmu_t *p_mmu);
+
 #endif /*APU_H_*/
\ No newline at end of file
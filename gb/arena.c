@@ -0,0 +1,90 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+arena_t *arena_allocate(size_t size)
+{
+    arena_t *p_arena = calloc(1, sizeof(arena_t));
+
+    if (p_arena)
+    {
+        p_arena->size = ARENA_SIZE(size);
+
+#ifdef _WIN32
+        p_arena->base = _aligned_malloc(p_arena->size, ARENA_ALIGN);
+#else
+        p_arena->base = aligned_alloc(ARENA_ALIGN, p_arena->size);
+#endif
+
+        if (!p_arena->base)
+        {
+            arena_free(p_arena);
+            return NULL;
+        }
+
+        (void)memset(p_arena->base, 0, p_arena->size);
+        p_arena->head = 0;
+        p_arena->tail = p_arena->size;
+    }
+
+    return p_arena;
+}
+
+void *arena_alloc(arena_t *p_arena, size_t size)
+{
+    if (!p_arena)
+        return NULL;
+
+    size = ARENA_SIZE(size);
+    if (size > (p_arena->tail - p_arena->head))
+    {
+        printf("Arena exhausted (%u bytes requested)\n", (unsigned int)size);
+        return NULL;
+    }
+
+    void *p = p_arena->base + p_arena->head;
+    p_arena->head += size;
+
+    return p;
+}
+
+void *arena_alloc_bulk(arena_t *p_arena, size_t size)
+{
+    if (!p_arena)
+        return NULL;
+
+    size = ARENA_SIZE(size);
+    if (size > (p_arena->tail - p_arena->head))
+    {
+        printf("Arena exhausted (%u bytes requested)\n", (unsigned int)size);
+        return NULL;
+    }
+
+    p_arena->tail -= size;
+
+    return p_arena->base + p_arena->tail;
+}
+
+void arena_free(arena_t *p_arena)
+{
+    if (p_arena)
+    {
+        if (p_arena->base)
+        {
+#ifdef _WIN32
+            _aligned_free(p_arena->base);
+#else
+            free(p_arena->base);
+#endif
+            p_arena->base = NULL;
+        }
+
+        free(p_arena);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Machine state arena.
+A single zeroed, cache line aligned block sized up front. State structures are
+allocated from the front in allocation order, so state used together sits on
+adjacent cache lines. Bulk buffers are allocated from the back, keeping them
+out of the way of the state. Memory is only released with the whole arena. */
+
+#define ARENA_ALIGN (64)
+#define ARENA_SIZE(size) (((size_t)(size) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct arena_s
+{
+    uint8_t *base;
+    size_t size;
+    size_t head; /* End of the front allocations. */
+    size_t tail; /* Start of the back allocations. */
+} arena_t;
+
+arena_t *arena_allocate(size_t size);
+
+/* State, allocated from the front. */
+void *arena_alloc(arena_t *p_arena, size_t size);
+
+/* Bulk buffers, allocated from the back. */
+void *arena_alloc_bulk(arena_t *p_arena, size_t size);
+
+void arena_free(arena_t *p_arena);
+
+#endif /*ARENA_H_*/
@@ -3,50 +3,309 @@
 
 #include "cpu_opcode8.h"
 #include "cpu_irq.h"
+#include "cpu_jit.h"
+#include "cpu_registers.h"
+#include "cpu_trace.h"
+#include "cpu_sampler.h"
+#include "cpu_stats.h"
+#include "timer.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-void cpu_init(void)
+static void cpu_run_batch(cpu_t *p_cpu);
+static void cpu_run_sampled(cpu_t *p_cpu, uint64_t until);
+
+size_t cpu_arena_size(void)
 {
-	opcode8_init();
+	return ARENA_SIZE(sizeof(cpu_t)) + ARENA_SIZE(CPU_ICACHE_SIZE * sizeof(cpu_icache_entry_t));
 }
 
-cpu_t *cpu_allocate(mmu_t *p_mmu)
+cpu_t *cpu_allocate(arena_t *p_arena, mmu_t *p_mmu)
 {
 	if (!p_mmu)
 		return NULL;
 
-	cpu_t *p_cpu = calloc(1, sizeof(cpu_t));
+	cpu_t *p_cpu = arena_alloc(p_arena, sizeof(cpu_t));
 
 	if (p_cpu)
 	{
+		p_cpu->icache = arena_alloc_bulk(p_arena, CPU_ICACHE_SIZE * sizeof(cpu_icache_entry_t));
+		if (!p_cpu->icache)
+			return NULL;
+
 		p_cpu->p_mmu = p_mmu;
+
+#ifdef CPU_STATS
+		p_cpu->stats = cpu_stats_allocate();
+		if (!p_cpu->stats)
+			return NULL;
+#endif
+
+		cpu_irq_register(p_cpu);
+		timer_register(p_cpu);
 	}
 
 	return p_cpu;
 }
 
-int cpu_execute(cpu_t *p_cpu)
+void cpu_run(cpu_t *p_cpu, uint64_t until)
 {
 	if (!p_cpu)
-		return 0;
+		return;
+
+	p_cpu->run_start = p_cpu->p_mmu->clock;
+	p_cpu->run_until = until;
+
+	if (p_cpu->sampler)
+	{
+		cpu_run_sampled(p_cpu, until);
+	}
+	else
+	{
+		cpu_run_batch(p_cpu);
+	}
+
+#ifdef CPU_STATS
+	/* The time up to the next batch is not the last instruction's. */
+	cpu_stats_pause(p_cpu->stats, p_cpu->p_mmu->clock);
+#endif
+}
+
+void cpu_flush_cache(cpu_t *p_cpu)
+{
+	if (p_cpu)
+	{
+		(void)memset(p_cpu->icache, 0, CPU_ICACHE_SIZE * sizeof(cpu_icache_entry_t));
+		cpu_jit_flush(p_cpu->jit);
+	}
+}
+
+int cpu_set_jit(cpu_t *p_cpu, int enabled)
+{
+	if (!p_cpu)
+		return -1;
+
+	if (enabled && !p_cpu->jit)
+	{
+		p_cpu->jit = cpu_jit_allocate();
+		if (!p_cpu->jit)
+			return -1;
+	}
+	else if (!enabled && p_cpu->jit)
+	{
+		cpu_jit_free(p_cpu->jit);
+		p_cpu->jit = NULL;
+	}
+
+	return 0;
+}
+
+int cpu_set_trace(cpu_t *p_cpu, int enabled)
+{
+	if (!p_cpu)
+		return -1;
+
+	if (enabled && !p_cpu->trace)
+	{
+		p_cpu->trace = cpu_trace_allocate();
+		if (!p_cpu->trace)
+			return -1;
+	}
+	else if (!enabled && p_cpu->trace)
+	{
+		cpu_trace_free(p_cpu->trace);
+		p_cpu->trace = NULL;
+	}
+
+	return 0;
+}
+
+int cpu_dump_trace(cpu_t *p_cpu, const char *path)
+{
+	if (!p_cpu)
+		return -1;
+
+	return cpu_trace_dump(p_cpu->trace, path);
+}
+
+int cpu_write_trace(cpu_t *p_cpu, int fd)
+{
+	if (!p_cpu)
+		return -1;
+
+	return cpu_trace_write(p_cpu->trace, fd);
+}
+
+int cpu_set_sampler(cpu_t *p_cpu, int period)
+{
+	if (!p_cpu)
+		return -1;
+
+	cpu_sampler_free(p_cpu->sampler);
+	p_cpu->sampler = NULL;
+
+	if (period > 0)
+	{
+		p_cpu->sampler = cpu_sampler_allocate(period);
+		if (!p_cpu->sampler)
+			return -1;
+	}
+
+	return 0;
+}
 
-	cpu_irq_process(p_cpu);
+int cpu_load_symbols(cpu_t *p_cpu, const char *path)
+{
+	if (!p_cpu)
+		return -1;
 
-	if (p_cpu->halted)
-		return 4;
+	return cpu_sampler_load_symbols(p_cpu->sampler, path);
+}
 
-	int cycles = opcode8_handler(p_cpu);
+void cpu_report_samples(cpu_t *p_cpu)
+{
+	if (p_cpu)
+	{
+		cpu_sampler_report(p_cpu->sampler);
+	}
+}
 
-	return cycles;
+void cpu_report_stats(cpu_t *p_cpu)
+{
+#ifdef CPU_STATS
+	if (p_cpu)
+	{
+		cpu_stats_report(p_cpu->stats);
+	}
+#else
+	(void)p_cpu;
+#endif
 }
 
+/* CPU state lives in the arena, only the JIT, trace, sampler and statistics
+are released. */
 void cpu_free(cpu_t *p_cpu)
 {
 	if (p_cpu)
 	{
-		free(p_cpu);
+		(void)cpu_set_jit(p_cpu, 0);
+		(void)cpu_set_trace(p_cpu, 0);
+		(void)cpu_set_sampler(p_cpu, 0);
+
+#ifdef CPU_STATS
+		cpu_stats_free(p_cpu->stats);
+		p_cpu->stats = NULL;
+#endif
+	}
+}
+
+void cpu_sync_flags(cpu_t *p_cpu)
+{
+	if (p_cpu)
+	{
+		flags_materialize(p_cpu);
+	}
+}
+
+void cpu_stop(cpu_t *p_cpu)
+{
+	if (p_cpu)
+	{
+		p_cpu->run_until = 0;
 	}
 }
 
 /* Private function definitions */
+
+/* ROM bank mapped at pc, 0 outside 0x4000 - 0x7FFF. */
+static inline int cpu_rom_bank(cpu_t *p_cpu, uint16_t pc)
+{
+	mmu_t *p_mmu = p_cpu->p_mmu;
+
+	return ((pc >= 0x4000) && (pc < 0x8000) && p_mmu->cartridge) ? p_mmu->cartridge->rom_bank : 0;
+}
+
+static void cpu_trace_record(cpu_t *p_cpu)
+{
+	mmu_t *p_mmu = p_cpu->p_mmu;
+	cpu_trace_entry_t *p_entry = cpu_trace_next(p_cpu->trace);
+	uint16_t pc = p_cpu->pc;
+
+	flags_materialize(p_cpu);
+
+	p_entry->clock = p_mmu->clock;
+	p_entry->pc = pc;
+	p_entry->sp = p_cpu->sp;
+	p_entry->af = p_cpu->reg_AF;
+	p_entry->bc = p_cpu->reg_BC;
+	p_entry->de = p_cpu->reg_DE;
+	p_entry->hl = p_cpu->reg_HL;
+	p_entry->bank = (uint16_t)cpu_rom_bank(p_cpu, pc);
+	p_entry->flags = p_cpu->irq_master_enable ? CPU_TRACE_IME : 0;
+	p_entry->size = 0;
+
+	/* Read in place only, a fetch through the MMU would show in watchpoints. */
+	const uint8_t *mem = p_mmu->p_pages[MMU_PAGE_INDEX(pc)].read_mem;
+	if (mem)
+	{
+		int length = opcode8_length(mem[MMU_PAGE_OFFSET(pc)]);
+
+		while ((p_entry->size < length) && ((MMU_PAGE_OFFSET(pc) + p_entry->size) < MMU_PAGE_SIZE))
+		{
+			p_entry->bytes[p_entry->size] = mem[MMU_PAGE_OFFSET(pc) + p_entry->size];
+			p_entry->size++;
+		}
+	}
+}
+
+/* One instruction at a time through opcode8_handler, so that each one gets
+its entry: no JIT blocks, fused pairs or HALT fast-forward. */
+static void cpu_run_traced(cpu_t *p_cpu)
+{
+	mmu_t *p_mmu = p_cpu->p_mmu;
+
+	do
+	{
+		cpu_irq_process(p_cpu);
+
+		if (p_cpu->halted)
+		{
+			mmu_advance(p_mmu, 4);
+		}
+		else
+		{
+			cpu_trace_record(p_cpu);
+			mmu_advance(p_mmu, opcode8_handler(p_cpu));
+		}
+	} while (p_mmu->clock < p_cpu->run_until);
+}
+
+/* Until run_until, through the recording loop when tracing. */
+static void cpu_run_batch(cpu_t *p_cpu)
+{
+	if (p_cpu->trace)
+	{
+		cpu_run_traced(p_cpu);
+		return;
+	}
+
+	opcode8_run(p_cpu);
+}
+
+/* Batches are cut at sample points, the sample goes to the next instruction
+to run. Stops like cpu_run when run_until is cleared by cpu_stop. */
+static void cpu_run_sampled(cpu_t *p_cpu, uint64_t until)
+{
+	mmu_t *p_mmu = p_cpu->p_mmu;
+
+	do
+	{
+		uint64_t next = cpu_sampler_next(p_cpu->sampler, p_mmu->clock);
+		p_cpu->run_until = (next < until) ? next : until;
+
+		cpu_run_batch(p_cpu);
+
+		cpu_sampler_record(p_cpu->sampler, p_mmu->clock, cpu_rom_bank(p_cpu, p_cpu->pc), p_cpu->pc);
+	} while (p_cpu->run_until && (p_mmu->clock < until));
+}
@@ -2,15 +2,55 @@
 #define CPU_H_
 
 #include "../mmu/mmu.h"
+#include "../arena.h"
+#include "cpu_sampler.h"
 
 typedef struct cpu_s cpu_t;
 
-void cpu_init(void);
+size_t cpu_arena_size(void);
 
-cpu_t *cpu_allocate(mmu_t *p_mmu);
+cpu_t *cpu_allocate(arena_t *p_arena, mmu_t *p_mmu);
 
-int cpu_execute(cpu_t *p_cpu);
+/* Execute instructions until the MMU clock reaches until, at least one. */
+void cpu_run(cpu_t *p_cpu, uint64_t until);
 
+/* Bring F in reg_AF up to date, needed before reading it from outside the CPU
+when built with CPU_LAZY_FLAGS. */
+void cpu_sync_flags(cpu_t *p_cpu);
+
+/* Return from cpu_run once the current instruction completes. */
+void cpu_stop(cpu_t *p_cpu);
+
+/* Drop all decoded instructions, needed when ROM or boot ROM change. */
+void cpu_flush_cache(cpu_t *p_cpu);
+
+/* Translate hot ROM code to host code, fails unless built with CPU_JIT on
+x86-64 Linux. Must be disabled before the CPU is released. */
+int cpu_set_jit(cpu_t *p_cpu, int enabled);
+
+/* Record every instruction in a ring buffer, see cpu_trace.h. Must be disabled
+before the CPU is released. */
+int cpu_set_trace(cpu_t *p_cpu, int enabled);
+
+/* Write the recorded instructions to path, fails unless tracing. */
+int cpu_dump_trace(cpu_t *p_cpu, const char *path);
+
+/* Same to an open file, async signal safe. */
+int cpu_write_trace(cpu_t *p_cpu, int fd);
+
+/* Count the pc every period cycles, see cpu_sampler.h. 0 disables, must be
+disabled before the CPU is released. */
+int cpu_set_sampler(cpu_t *p_cpu, int period);
+
+/* Load a .sym file for cpu_report_samples, fails unless sampling. */
+int cpu_load_symbols(cpu_t *p_cpu, const char *path);
+
+void cpu_report_samples(cpu_t *p_cpu);
+
+/* Opcode counts and host time per opcode class on stdout, needs CPU_STATS. */
+void cpu_report_stats(cpu_t *p_cpu);
+
+/* Release the JIT, trace, sampler and statistics, the rest is in the arena. */
 void cpu_free(cpu_t *p_cpu);
 
 #endif /*CPU_H_*/
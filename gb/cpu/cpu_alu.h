@@ -5,120 +5,155 @@
 #include "cpu_def.h"
 #include "cpu_utils.h"
 
+/* With CPU_LAZY_FLAGS the helpers below only record their operands and result,
+F is computed when a flag is read (conditional jumps, PUSH AF, DAA, debugger). */
+
 static inline void alu_ADD(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 
     uint16_t result = (uint16_t)reg_a;
     result += (uint16_t)operand;
 
-    set_msb(&p_cpu->reg_AF, result);
+    set_reg3(p_cpu, REG3_A, result);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_ADD, reg_a, operand, 0, result);
+#else
     set_flag_Z(p_cpu, 0 == (result & 0x00FF));
     set_flag_N(p_cpu, 0);
     set_flag_H(p_cpu, ((reg_a & 0x0F) + (operand & 0x0F)) > 0x0F);
     set_flag_C(p_cpu, result > 0xFF);
+#endif
 }
 
 static inline void alu_ADC(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
     uint8_t flag_c = get_flag_C(p_cpu);
 
     uint16_t result = (uint16_t)reg_a;
     result += (uint16_t)operand;
     result += (uint16_t)flag_c;
 
-    set_msb(&p_cpu->reg_AF, result);
+    set_reg3(p_cpu, REG3_A, result);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_ADC, reg_a, operand, flag_c, result);
+#else
     set_flag_Z(p_cpu, 0 == (result & 0x00FF));
     set_flag_N(p_cpu, 0);
     set_flag_H(p_cpu, ((reg_a & 0x0F) + (operand & 0x0F) + flag_c) > 0x0F);
     set_flag_C(p_cpu, (result > 0x00FF));
+#endif
 }
 
 static inline void alu_SUB(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 
     uint16_t result = (uint16_t)reg_a;
     result -= (uint16_t)operand;
 
-    set_msb(&p_cpu->reg_AF, result);
+    set_reg3(p_cpu, REG3_A, result);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_SUB, reg_a, operand, 0, result);
+#else
     set_flag_Z(p_cpu, (reg_a == operand));
     set_flag_N(p_cpu, 1);
     set_flag_H(p_cpu, ((reg_a & 0x0F) < (operand & 0x0F)));
     set_flag_C(p_cpu, (reg_a < operand));
+#endif
 }
 
 static inline void alu_SBC(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
     uint8_t flag_c = get_flag_C(p_cpu);
 
     uint16_t result = (uint16_t)reg_a;
     result -= (uint16_t)operand;
     result -= (uint16_t)flag_c;
 
-    set_msb(&p_cpu->reg_AF, result);
+    set_reg3(p_cpu, REG3_A, result);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_SBC, reg_a, operand, flag_c, result);
+#else
     set_flag_Z(p_cpu, 0 == (result & (uint16_t)0x00FF));
     set_flag_N(p_cpu, 1);
     set_flag_H(p_cpu, ((reg_a & 0x0F) < ((operand & 0x0F) + flag_c)));
     set_flag_C(p_cpu, result > (uint16_t)0xFF);
+#endif
 }
 
 static inline void alu_AND(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 
     reg_a &= operand;
 
-    set_msb(&p_cpu->reg_AF, reg_a);
+    set_reg3(p_cpu, REG3_A, reg_a);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_AND, 0, 0, 0, reg_a);
+#else
     set_flag_Z(p_cpu, (reg_a == 0));
     set_flag_N(p_cpu, 0);
     set_flag_H(p_cpu, 1);
     set_flag_C(p_cpu, 0);
+#endif
 }
 
 static inline void alu_XOR(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 
     reg_a ^= operand;
 
-    set_msb(&p_cpu->reg_AF, reg_a);
+    set_reg3(p_cpu, REG3_A, reg_a);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_OR, 0, 0, 0, reg_a);
+#else
     set_flag_Z(p_cpu, (reg_a == 0));
     set_flag_N(p_cpu, 0);
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, 0);
+#endif
 }
 
 static inline void alu_OR(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 
     reg_a |= operand;
 
-    set_msb(&(p_cpu->reg_AF), reg_a);
+    set_reg3(p_cpu, REG3_A, reg_a);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_OR, 0, 0, 0, reg_a);
+#else
     set_flag_Z(p_cpu, (reg_a == 0));
     set_flag_N(p_cpu, 0);
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, 0);
+#endif
 }
 
 static inline void alu_CP(cpu_t *p_cpu, uint8_t operand)
 {
-    uint8_t reg_a = get_msb(p_cpu->reg_AF);
+    uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 
+#ifdef CPU_LAZY_FLAGS
+    flags_record(p_cpu, CPU_FLAGS_SUB, reg_a, operand, 0, (uint16_t)(reg_a - operand));
+#else
     set_flag_Z(p_cpu, (reg_a == operand));
     set_flag_N(p_cpu, 1);
     set_flag_H(p_cpu, ((reg_a & 0x0F) < (operand & 0x0F)));
     set_flag_C(p_cpu, (reg_a < operand));
+#endif
 }
 
 #endif /*_CPU_ALU_H_*/
\ No newline at end of file
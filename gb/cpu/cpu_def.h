@@ -2,18 +2,80 @@
 #define CPU_DEF_H_
 
 #include "mmu.h"
+#include "cpu_trace.h"
+#include "cpu_sampler.h"
+#include "cpu_stats.h"
 #include <stdint.h>
 
+#define CPU_ICACHE_SIZE (0x4000)
+#define CPU_ICACHE_MASK (CPU_ICACHE_SIZE - 1)
+
+/* Decoded instruction, slot pc & CPU_ICACHE_MASK.
+Tagged with the host address of the opcode, which tells ROM / RAM banks apart. */
+typedef struct cpu_icache_entry_s
+{
+    const uint8_t *tag;
+    uint16_t operand;
+    uint16_t opcode; /* Or OPCODE_COUNT + n for fused pair n, see cpu_opcode8.c. */
+    uint8_t length;
+} cpu_icache_entry_t;
+
+typedef struct cpu_jit_s cpu_jit_t;
+
+/* Byte of an 8 bit register in cpu_t.r8, from its 3 bit opcode field
+(B, C, D, E, H, L, -, A). The high register of a pair comes first on big
+endian hosts, second on little endian ones. */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define CPU_R8_HIGH (0)
+#else
+#define CPU_R8_HIGH (1)
+#endif
+#define CPU_R8_INDEX(r) (((r) == 7) ? (6 | CPU_R8_HIGH) : (((r)&6) | (((r)&1) ^ CPU_R8_HIGH)))
+
+#ifdef CPU_LAZY_FLAGS
+/* Last ALU operation, F is computed from it when read. */
+typedef enum cpu_flags_op_e
+{
+    CPU_FLAGS_NONE, /* F in reg_AF is up to date. */
+    CPU_FLAGS_ADD,
+    CPU_FLAGS_ADC,
+    CPU_FLAGS_SUB,
+    CPU_FLAGS_SBC,
+    CPU_FLAGS_AND,
+    CPU_FLAGS_OR /* OR and XOR. */
+} cpu_flags_op_t;
+#endif
+
 typedef struct cpu_s
 {
-    uint16_t reg_AF;
-    uint16_t reg_BC;
-    uint16_t reg_DE;
-    uint16_t reg_HL;
+    /* Register file, 8 bit registers indexed with CPU_R8_INDEX, pairs with
+    their 2 bit opcode field (BC, DE, HL, then AF). */
+    union
+    {
+        uint8_t r8[8];
+        uint16_t r16[4];
+        struct
+        {
+            uint16_t reg_BC;
+            uint16_t reg_DE;
+            uint16_t reg_HL;
+            uint16_t reg_AF;
+        };
+    };
 
     uint16_t sp;
     uint16_t pc;
 
+    uint16_t operand; /* Immediate operand of the current instruction. */
+
+#ifdef CPU_LAZY_FLAGS
+    uint8_t flags_op; /* cpu_flags_op_t, F bits of reg_AF are stale unless CPU_FLAGS_NONE. */
+    uint8_t flags_a;
+    uint8_t flags_b;
+    uint8_t flags_carry;
+    uint16_t flags_result;
+#endif
+
     mmu_t *p_mmu;
 
     uint8_t irq_master_enable;
@@ -22,9 +84,25 @@ typedef struct cpu_s
 
     int halted;
 
+    uint64_t run_start; /* MMU clock at which cpu_run was called. */
+    uint64_t run_until; /* MMU clock at which cpu_run returns. */
+
+    uint64_t poll_clock;       /* MMU clock of the last LD A, (FF00+n). */
+    uint64_t busy_wait_cycles; /* Cycles skipped in polling loops. */
+
+    cpu_icache_entry_t *icache;
+    cpu_jit_t *jit;         /* NULL unless the JIT is enabled, lives outside the arena. */
+    cpu_trace_t *trace;     /* NULL unless tracing, lives outside the arena. */
+    cpu_sampler_t *sampler; /* NULL unless profiling, lives outside the arena. */
+
+#ifdef CPU_STATS
+    cpu_stats_t *stats; /* Lives outside the arena. */
+#endif
+
     int div_counter;
     int tim_counter;
     int tim_clock;
+    int tim_enabled;
 } cpu_t;
 
 #endif /*CPU_DEF_H_*/
\ No newline at end of file
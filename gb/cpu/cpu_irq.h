@@ -10,7 +10,7 @@
 #define IF_REG_ADDR (0xFF0F)
 #define IE_REG_ADDR (0xFFFF)
 
-const uint16_t VECTOR_TABLE[IRQ_COUNT] = {
+static const uint16_t VECTOR_TABLE[IRQ_COUNT] = {
     0x0040, //Vertical blank
     0x0048, //LCD status triggers
     0x0050, //Timer overflow
@@ -18,6 +18,20 @@ const uint16_t VECTOR_TABLE[IRQ_COUNT] = {
     0x0060  //Joypad press
 };
 
+/* IF upper bits are unused and read as 1. */
+static inline int cpu_irq_io_read_if(void *p_context, uint16_t address, uint8_t *data)
+{
+    cpu_t *p_cpu = p_context;
+
+    *data = mmu_io_get(p_cpu->p_mmu, address) | 0xE0;
+    return 0;
+}
+
+static inline void cpu_irq_register(cpu_t *p_cpu)
+{
+    (void)mmu_register_io(p_cpu->p_mmu, IF_REG_ADDR, cpu_irq_io_read_if, NULL, p_cpu);
+}
+
 static inline void cpu_irq_process(cpu_t *p_cpu)
 {
     /* Update IME flag. */
@@ -42,9 +56,8 @@ static inline void cpu_irq_process(cpu_t *p_cpu)
     /* Process IRQs */
     if (p_cpu->irq_master_enable || p_cpu->halted)
     {
-        uint8_t irq_flag, irq_enable;
-        (void)mmu_read_u8(p_cpu->p_mmu, IF_REG_ADDR, &irq_flag);
-        (void)mmu_read_u8(p_cpu->p_mmu, IE_REG_ADDR, &irq_enable);
+        uint8_t irq_flag = mmu_io_get(p_cpu->p_mmu, IF_REG_ADDR);
+        uint8_t irq_enable = mmu_io_get(p_cpu->p_mmu, IE_REG_ADDR);
 
         irq_flag &= (irq_enable & 0x1F); // Mask disabled irqs.
 
@@ -57,8 +70,8 @@ static inline void cpu_irq_process(cpu_t *p_cpu)
                 {
                     if (p_cpu->irq_master_enable)
                     {
-                        irq_flag &= ~mask; // Clear interrupt flag.
-                        (void)mmu_write_u8(p_cpu->p_mmu, IF_REG_ADDR, irq_flag);
+                        // Clear interrupt flag, keep pending disabled irqs.
+                        mmu_io_set(p_cpu->p_mmu, IF_REG_ADDR, mmu_io_get(p_cpu->p_mmu, IF_REG_ADDR) & ~mask);
 
                         p_cpu->irq_master_enable = 0; // Disable interrupts.
 
@@ -0,0 +1,317 @@
+#include "cpu_jit.h"
+
+#include "cpu_opcode8.h"
+#include "cpu_opcode16.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CPU_JIT_ENABLED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* Defines */
+
+#define JIT_BLOCK_COUNT (0x4000)
+#define JIT_BLOCK_MASK (JIT_BLOCK_COUNT - 1)
+#define JIT_BLOCK_LENGTH (32)               /* Instructions per block at most. */
+#define JIT_CODE_SIZE (4 * 1024 * 1024)     /* Flushed as a whole when full, page multiple. */
+#define JIT_INSTRUCTION_SIZE (64)           /* Host code per instruction at most. */
+#define JIT_NEVER (0xFFFFFFFFu)             /* Block count of code that cannot be translated. */
+
+/* Typedefs */
+
+typedef void (*jit_code_t)(cpu_t *p_cpu, mmu_t *p_mmu);
+
+/* Block starting at slot pc & JIT_BLOCK_MASK, tagged with the host address of
+its first opcode like the instruction cache. */
+typedef struct jit_block_s
+{
+	const uint8_t *tag;
+	jit_code_t code;
+	uint32_t count;
+} jit_block_t;
+
+struct cpu_jit_s
+{
+	jit_block_t blocks[JIT_BLOCK_COUNT];
+	uint8_t *code;
+	size_t code_used;
+};
+
+/* Private function declarations */
+
+#ifdef CPU_JIT_ENABLED
+static int jit_protect(cpu_jit_t *p_jit, size_t start, size_t size, int prot);
+static int jit_translate(cpu_jit_t *p_jit, jit_block_t *p_block, const uint8_t *mem, uint16_t pc);
+#endif
+
+/* Public function definitions */
+
+cpu_jit_t *cpu_jit_allocate(void)
+{
+#ifdef CPU_JIT_ENABLED
+	cpu_jit_t *p_jit = calloc(1, sizeof(cpu_jit_t));
+	if (!p_jit)
+		return NULL;
+
+	/* Never writable and executable at once, see jit_translate. */
+	p_jit->code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p_jit->code == MAP_FAILED)
+	{
+		printf("JIT code buffer allocation failed.\n");
+		free(p_jit);
+		return NULL;
+	}
+
+	return p_jit;
+#else
+	return NULL;
+#endif
+}
+
+void cpu_jit_free(cpu_jit_t *p_jit)
+{
+#ifdef CPU_JIT_ENABLED
+	if (p_jit)
+	{
+		(void)munmap(p_jit->code, JIT_CODE_SIZE);
+		free(p_jit);
+	}
+#else
+	(void)p_jit;
+#endif
+}
+
+void cpu_jit_flush(cpu_jit_t *p_jit)
+{
+	if (p_jit)
+	{
+		(void)memset(p_jit->blocks, 0, sizeof(p_jit->blocks));
+		p_jit->code_used = 0;
+	}
+}
+
+int cpu_jit_execute(cpu_t *p_cpu)
+{
+#ifdef CPU_JIT_ENABLED
+	cpu_jit_t *p_jit = p_cpu->jit;
+	mmu_t *p_mmu = p_cpu->p_mmu;
+	uint16_t pc = p_cpu->pc;
+
+	/* Blocks do not check IRQs, an EI / DI taking effect after the next
+	instruction has to go through the interpreter. */
+	if (p_cpu->ei_counter || p_cpu->di_counter)
+		return 0;
+
+	/* ROM only, read in place (not trapped by a watchpoint, no DMA). */
+	const uint8_t *mem = p_mmu->p_pages[MMU_PAGE_INDEX(pc)].read_mem;
+	if ((MMU_PAGE_INDEX(pc) >= MMU_DIRTY_FIRST_PAGE) || !mem)
+		return 0;
+
+	jit_block_t *p_block = &p_jit->blocks[pc & JIT_BLOCK_MASK];
+	if (p_block->tag != &mem[MMU_PAGE_OFFSET(pc)])
+	{
+		p_block->tag = &mem[MMU_PAGE_OFFSET(pc)];
+		p_block->code = NULL;
+		p_block->count = 0;
+	}
+
+	if (!p_block->code)
+	{
+		if ((p_block->count == JIT_NEVER) || (++p_block->count < CPU_JIT_HOT))
+			return 0;
+
+		if (jit_translate(p_jit, p_block, mem, pc) < 0)
+		{
+			p_block->count = JIT_NEVER;
+			return 0;
+		}
+	}
+
+	p_block->code(p_cpu, p_mmu);
+	return 1;
+#else
+	(void)p_cpu;
+	return 0;
+#endif
+}
+
+/* Private function definitions */
+
+#ifdef CPU_JIT_ENABLED
+
+/* Protect the pages holding code [start, start + size). */
+static int jit_protect(cpu_jit_t *p_jit, size_t start, size_t size, int prot)
+{
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t first = start & ~(page_size - 1);
+	size_t end = (start + size + page_size - 1) & ~(page_size - 1);
+
+	return mprotect(p_jit->code + first, end - first, prot);
+}
+
+static void jit_emit(uint8_t **pp_code, const void *data, size_t size)
+{
+	(void)memcpy(*pp_code, data, size);
+	*pp_code += size;
+}
+
+static void jit_emit_u16(uint8_t **pp_code, uint16_t value)
+{
+	jit_emit(pp_code, &value, sizeof(value));
+}
+
+static void jit_emit_u32(uint8_t **pp_code, uint32_t value)
+{
+	jit_emit(pp_code, &value, sizeof(value));
+}
+
+static void jit_emit_u64(uint8_t **pp_code, uint64_t value)
+{
+	jit_emit(pp_code, &value, sizeof(value));
+}
+
+/* Instructions ending a block: control transfers, and those changing the
+interrupt state, checked by the interpreter before each instruction. */
+static int jit_block_end(uint8_t opcode)
+{
+	return (opcode == 0x18) || ((opcode & 0xE7) == 0x20) ||                   /* JR, JR F */
+		   (opcode == 0xC3) || ((opcode & 0xE7) == 0xC2) || (opcode == 0xE9) || /* JP, JP F, JP HL */
+		   (opcode == 0xCD) || ((opcode & 0xE7) == 0xC4) ||                   /* CALL, CALL F */
+		   (opcode == 0xC9) || ((opcode & 0xE7) == 0xC0) || (opcode == 0xD9) || /* RET, RET F, RETI */
+		   ((opcode & 0xC7) == 0xC7) ||                                       /* RST */
+		   (opcode == 0x76) || (opcode == 0x10) ||                            /* HALT, STOP */
+		   (opcode == 0xF3) || (opcode == 0xFB);                              /* DI, EI */
+}
+
+/* Host code, System V calling convention:
+	push rbx; push r12; sub rsp, 8          rbx = p_cpu, r12 = p_mmu
+	mov rbx, rdi; mov r12, rsi
+	For each instruction:
+	mov word [rbx + operand], n             with an immediate operand
+	mov rdi, rbx; mov rax, handler; call rax
+	mov eax, eax; add [r12 + clock], rax
+	mov rax, [r12 + clock]                  but after the last one
+	cmp rax, [rbx + run_until]; jae exit
+	exit: add rsp, 8; pop r12; pop rbx; ret
+The handlers are the interpreter ones, only fetch and dispatch are left out.
+The pages written are made writable for the translation, then executable
+again. Blocks sharing them are not run meanwhile. */
+static int jit_translate(cpu_jit_t *p_jit, jit_block_t *p_block, const uint8_t *mem, uint16_t pc)
+{
+	static const uint8_t prologue[] = {0x53, 0x41, 0x54, 0x48, 0x83, 0xEC, 0x08, 0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4};
+	static const uint8_t epilogue[] = {0x48, 0x83, 0xC4, 0x08, 0x41, 0x5C, 0x5B, 0xC3};
+
+	size_t size_max = sizeof(prologue) + (JIT_BLOCK_LENGTH * JIT_INSTRUCTION_SIZE) + sizeof(epilogue);
+	if ((p_jit->code_used + size_max) > JIT_CODE_SIZE)
+	{
+		/* Full, start over. p_block was just tagged, keep it. */
+		const uint8_t *tag = p_block->tag;
+		cpu_jit_flush(p_jit);
+		p_block->tag = tag;
+	}
+
+	if (jit_protect(p_jit, p_jit->code_used, size_max, PROT_READ | PROT_WRITE) < 0)
+	{
+		printf("JIT code protection failed.\n");
+		cpu_jit_flush(p_jit);
+		return -1;
+	}
+
+	uint8_t *start = p_jit->code + p_jit->code_used;
+	uint8_t *p_code = start;
+	uint8_t *exits[JIT_BLOCK_LENGTH];
+	int exit_count = 0;
+
+	jit_emit(&p_code, prologue, sizeof(prologue));
+
+	uint16_t offset = MMU_PAGE_OFFSET(pc);
+	int count = 0;
+
+	while (count < JIT_BLOCK_LENGTH)
+	{
+		uint8_t opcode = mem[offset];
+		int length = opcode8_length(opcode);
+
+		/* Left to the interpreter, the block ends before them. */
+		if (!opcode8_legal(opcode))
+			break;
+
+		/* Instructions stay in the page, it is all the tag covers. */
+		if ((offset + length) > MMU_PAGE_SIZE)
+			break;
+
+		uint16_t operand = 0;
+		if (length == 2)
+		{
+			operand = mem[offset + 1];
+		}
+		else if (length == 3)
+		{
+			operand = (uint16_t)(mem[offset + 1] | (mem[offset + 2] << 8));
+		}
+		opcode_handler_t handler = opcode8_handler_get(opcode);
+
+		if (opcode == 0xCB)
+		{
+			/* Straight to the CB handler, which does not need the operand. */
+			handler = opcode16_handler_get((uint8_t)operand);
+		}
+		else if (length > 1)
+		{
+			jit_emit(&p_code, (const uint8_t[]){0x66, 0xC7, 0x83}, 3);
+			jit_emit_u32(&p_code, offsetof(cpu_t, operand));
+			jit_emit_u16(&p_code, operand);
+		}
+
+		jit_emit(&p_code, (const uint8_t[]){0x48, 0x89, 0xDF, 0x48, 0xB8}, 5);
+		jit_emit_u64(&p_code, (uint64_t)(uintptr_t)handler);
+		jit_emit(&p_code, (const uint8_t[]){0xFF, 0xD0, 0x89, 0xC0, 0x49, 0x01, 0x84, 0x24}, 8);
+		jit_emit_u32(&p_code, offsetof(mmu_t, clock));
+
+		count++;
+		offset += length;
+
+		if (jit_block_end(opcode) || (count == JIT_BLOCK_LENGTH))
+			break;
+
+		jit_emit(&p_code, (const uint8_t[]){0x49, 0x8B, 0x84, 0x24}, 4);
+		jit_emit_u32(&p_code, offsetof(mmu_t, clock));
+		jit_emit(&p_code, (const uint8_t[]){0x48, 0x3B, 0x83}, 3);
+		jit_emit_u32(&p_code, offsetof(cpu_t, run_until));
+		jit_emit(&p_code, (const uint8_t[]){0x0F, 0x83}, 2);
+		exits[exit_count++] = p_code;
+		jit_emit_u32(&p_code, 0);
+	}
+
+	for (int i = 0; i < exit_count; i++)
+	{
+		uint32_t rel = (uint32_t)(p_code - (exits[i] + 4));
+		(void)memcpy(exits[i], &rel, sizeof(rel));
+	}
+
+	jit_emit(&p_code, epilogue, sizeof(epilogue));
+
+	/* Blocks sharing the pages would not run anymore, drop them all. */
+	if (jit_protect(p_jit, p_jit->code_used, size_max, PROT_READ | PROT_EXEC) < 0)
+	{
+		printf("JIT code protection failed.\n");
+		cpu_jit_flush(p_jit);
+		return -1;
+	}
+
+	/* Nothing translated, the code emitted is left unused. */
+	if (!count)
+		return -1;
+
+	p_jit->code_used += (size_t)(p_code - start);
+	p_block->code = (jit_code_t)(void *)start;
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef CPU_JIT_H_
+#define CPU_JIT_H_
+
+#include "cpu_def.h"
+
+/* Basic block translator for ROM code.
+Only built with CPU_JIT, on x86-64 Linux. A block is the straight line code up
+to the first jump, call, return, EI / DI or HALT / STOP, translated after it ran
+CPU_JIT_HOT times into calls to the specialized opcode handlers. */
+#if defined(CPU_JIT) && defined(__x86_64__) && defined(__linux__)
+#define CPU_JIT_SUPPORTED
+#endif
+
+/* Blocks are not counted by the memory profiler nor the opcode statistics,
+builds with either run the interpreter only and cpu_jit_allocate fails. */
+#if defined(CPU_JIT_SUPPORTED) && !defined(MMU_PROFILE) && !defined(CPU_STATS)
+#define CPU_JIT_ENABLED
+#endif
+
+#define CPU_JIT_HOT (16)
+
+cpu_jit_t *cpu_jit_allocate(void);
+
+void cpu_jit_free(cpu_jit_t *p_jit);
+
+/* Drop all blocks, needed when ROM or boot ROM change. */
+void cpu_jit_flush(cpu_jit_t *p_jit);
+
+/* Run the block at pc, returns 0 when there is none and the interpreter has
+to execute the next instruction. Exits like the interpreter: once the MMU clock
+reaches p_cpu->run_until, checked after each instruction. */
+int cpu_jit_execute(cpu_t *p_cpu);
+
+#endif /*CPU_JIT_H_*/
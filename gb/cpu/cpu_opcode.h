@@ -2,17 +2,29 @@
 #define CPU_OPCODE_H_
 
 #include "cpu_def.h"
+#include "cpu_utils.h"
 
 typedef int (*opcode_handler_t)(cpu_t *p_cpu);
 
-typedef struct opcode_entry_s
-{
-    uint8_t mask;
-    uint8_t opcode;
-    opcode_handler_t handler;
-} opcode_entry_t;
+/* Opcode tables are generated at compile time: OPCODE_TABLE(X) expands X once
+per opcode, 0x00 to 0xFF, each handler being a decoder called with a constant
+opcode so operand fields fold into the handler. */
 
-void opcode_init(const opcode_entry_t opcode_entries[], int entries_count, opcode_handler_t opcode_handlers[], int handlers_count);
+/* First matching entry wins, see the decoders. */
+#define OPCODE_MATCH(mask, value, handler) \
+    if (((opcode) & (mask)) == (value))    \
+    return handler
+
+#define OPCODE_ROW(X, row)                                                                                 \
+    X(0x##row##0) X(0x##row##1) X(0x##row##2) X(0x##row##3) X(0x##row##4) X(0x##row##5) X(0x##row##6) \
+    X(0x##row##7) X(0x##row##8) X(0x##row##9) X(0x##row##A) X(0x##row##B) X(0x##row##C) X(0x##row##D) \
+    X(0x##row##E) X(0x##row##F)
+
+#define OPCODE_TABLE(X)                                                              \
+    OPCODE_ROW(X, 0) OPCODE_ROW(X, 1) OPCODE_ROW(X, 2) OPCODE_ROW(X, 3)             \
+    OPCODE_ROW(X, 4) OPCODE_ROW(X, 5) OPCODE_ROW(X, 6) OPCODE_ROW(X, 7)             \
+    OPCODE_ROW(X, 8) OPCODE_ROW(X, 9) OPCODE_ROW(X, A) OPCODE_ROW(X, B)             \
+    OPCODE_ROW(X, C) OPCODE_ROW(X, D) OPCODE_ROW(X, E) OPCODE_ROW(X, F)
 
 int opcode_UNHANDLED(cpu_t *p_cpu);
 
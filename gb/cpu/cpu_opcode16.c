@@ -4,23 +4,11 @@
 #include "cpu_registers.h"
 #include "mmu.h"
 
-#if 0
-#define DBG_ENABLED
-static int debug_enabled = 0;
-
-#define DEBUG_PRINT(fmt, ...) \
-    if (debug_enabled)        \
-    printf(fmt, __VA_ARGS__)
-#else
-#define DEBUG_PRINT(fmt, ...) (void)0
-#endif /*NDEBUG*/
-
 #include <stdio.h>
 
 /* Defines */
 
 #define OPCODE_COUNT (256)
-#define ENTRY_COUNT (sizeof(opcode16_entries) / sizeof(opcode_entry_t))
 
 /* Typedefs */
 
@@ -28,90 +16,95 @@ static int debug_enabled = 0;
 
 /* Private variables */
 
-opcode_handler_t opcode16_handlers[OPCODE_COUNT] = {NULL};
-
 /* Private function declarations */
 
-static int opcode16_RLC_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_RLC_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_RLC_HL(cpu_t *p_cpu);
-static int opcode16_RRC_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_RRC_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_RRC_HL(cpu_t *p_cpu);
-static int opcode16_RL_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_RL_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_RL_HL(cpu_t *p_cpu);
-static int opcode16_RR_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_RR_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_RR_HL(cpu_t *p_cpu);
-static int opcode16_SLA_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_SLA_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_SLA_HL(cpu_t *p_cpu);
-static int opcode16_SRA_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_SRA_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_SRA_HL(cpu_t *p_cpu);
-static int opcode16_SWAP_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_SWAP_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_SWAP_HL(cpu_t *p_cpu);
-static int opcode16_SRL_D(cpu_t *p_cpu);
+CPU_INLINE int opcode16_SRL_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode16_SRL_HL(cpu_t *p_cpu);
-static int opcode16_BIT_N_D(cpu_t *p_cpu);
-static int opcode16_BIT_N_HL(cpu_t *p_cpu);
-static int opcode16_RES_N_D(cpu_t *p_cpu);
-static int opcode16_RES_N_HL(cpu_t *p_cpu);
-static int opcode16_SET_N_D(cpu_t *p_cpu);
-static int opcode16_SET_N_HL(cpu_t *p_cpu);
-
-static const opcode_entry_t opcode16_entries[] = {
-    {0xFF, 0x06, opcode16_RLC_HL},   // RLC (HL)
-    {0xFF, 0x0E, opcode16_RRC_HL},   // RRC (HL)
-    {0xFF, 0x16, opcode16_RL_HL},    // RL (HL)
-    {0xFF, 0x1E, opcode16_RR_HL},    // RR (HL)
-    {0xFF, 0x26, opcode16_SLA_HL},   // SLA (HL)
-    {0xFF, 0x2E, opcode16_SRA_HL},   // SRA (HL)
-    {0xFF, 0x36, opcode16_SWAP_HL},  // SWAP (HL)
-    {0xFF, 0x3E, opcode16_SRL_HL},   // SRL (HL)
-    {0xC7, 0x46, opcode16_BIT_N_HL}, // BIT N, (HL)
-    {0xC7, 0x86, opcode16_RES_N_HL}, // RES N, (HL)
-    {0xC7, 0xC6, opcode16_SET_N_HL}, // SET N, (HL)
-    {0xF8, 0x00, opcode16_RLC_D},    // RLC D
-    {0xF8, 0x08, opcode16_RRC_D},    // RRC D
-    {0xF8, 0x10, opcode16_RL_D},     // RL D
-    {0xF8, 0x18, opcode16_RR_D},     // RR D
-    {0xF8, 0x20, opcode16_SLA_D},    // SLA D
-    {0xF8, 0x28, opcode16_SRA_D},    // SRA D
-    {0xF8, 0x30, opcode16_SWAP_D},   // SWAP D
-    {0xF8, 0x38, opcode16_SRL_D},    // SRL D
-    {0xC0, 0x40, opcode16_BIT_N_D},  // BIT N, D
-    {0xC0, 0x80, opcode16_RES_N_D},  // RES N, D
-    {0xC0, 0xC0, opcode16_SET_N_D},  // SET N, D
-    {0x00, 0x00, opcode_UNHANDLED}};
+CPU_INLINE int opcode16_BIT_N_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode16_BIT_N_HL(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode16_RES_N_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode16_RES_N_HL(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode16_SET_N_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode16_SET_N_HL(cpu_t *p_cpu, uint8_t opcode);
+
+/* Decoder, entries are matched in order. Called with a constant opcode by
+the handlers below, the matching reduces to the handler call. */
+CPU_INLINE int opcode16_decode(cpu_t *p_cpu, uint8_t opcode)
+{
+    OPCODE_MATCH(0xFF, 0x06, opcode16_RLC_HL(p_cpu));           // RLC (HL)
+    OPCODE_MATCH(0xFF, 0x0E, opcode16_RRC_HL(p_cpu));           // RRC (HL)
+    OPCODE_MATCH(0xFF, 0x16, opcode16_RL_HL(p_cpu));            // RL (HL)
+    OPCODE_MATCH(0xFF, 0x1E, opcode16_RR_HL(p_cpu));            // RR (HL)
+    OPCODE_MATCH(0xFF, 0x26, opcode16_SLA_HL(p_cpu));           // SLA (HL)
+    OPCODE_MATCH(0xFF, 0x2E, opcode16_SRA_HL(p_cpu));           // SRA (HL)
+    OPCODE_MATCH(0xFF, 0x36, opcode16_SWAP_HL(p_cpu));          // SWAP (HL)
+    OPCODE_MATCH(0xFF, 0x3E, opcode16_SRL_HL(p_cpu));           // SRL (HL)
+    OPCODE_MATCH(0xC7, 0x46, opcode16_BIT_N_HL(p_cpu, opcode)); // BIT N, (HL)
+    OPCODE_MATCH(0xC7, 0x86, opcode16_RES_N_HL(p_cpu, opcode)); // RES N, (HL)
+    OPCODE_MATCH(0xC7, 0xC6, opcode16_SET_N_HL(p_cpu, opcode)); // SET N, (HL)
+    OPCODE_MATCH(0xF8, 0x00, opcode16_RLC_D(p_cpu, opcode));    // RLC D
+    OPCODE_MATCH(0xF8, 0x08, opcode16_RRC_D(p_cpu, opcode));    // RRC D
+    OPCODE_MATCH(0xF8, 0x10, opcode16_RL_D(p_cpu, opcode));     // RL D
+    OPCODE_MATCH(0xF8, 0x18, opcode16_RR_D(p_cpu, opcode));     // RR D
+    OPCODE_MATCH(0xF8, 0x20, opcode16_SLA_D(p_cpu, opcode));    // SLA D
+    OPCODE_MATCH(0xF8, 0x28, opcode16_SRA_D(p_cpu, opcode));    // SRA D
+    OPCODE_MATCH(0xF8, 0x30, opcode16_SWAP_D(p_cpu, opcode));   // SWAP D
+    OPCODE_MATCH(0xF8, 0x38, opcode16_SRL_D(p_cpu, opcode));    // SRL D
+    OPCODE_MATCH(0xC0, 0x40, opcode16_BIT_N_D(p_cpu, opcode));  // BIT N, D
+    OPCODE_MATCH(0xC0, 0x80, opcode16_RES_N_D(p_cpu, opcode));  // RES N, D
+    OPCODE_MATCH(0xC0, 0xC0, opcode16_SET_N_D(p_cpu, opcode));  // SET N, D
+
+    return opcode_UNHANDLED(p_cpu);
+}
+
+#define OPCODE16_HANDLER(opcode)                 \
+    static int opcode16_##opcode(cpu_t *p_cpu)   \
+    {                                            \
+        CPU_STATS_OPCODE(p_cpu, 0x100 | opcode); \
+        return opcode16_decode(p_cpu, opcode);   \
+    }
+
+OPCODE_TABLE(OPCODE16_HANDLER)
+
+#define OPCODE16_ENTRY(opcode) opcode16_##opcode,
+
+static const opcode_handler_t opcode16_handlers[OPCODE_COUNT] = {OPCODE_TABLE(OPCODE16_ENTRY)};
 
 /* Inlined private function definitions */
 
 /* Public function definitions */
 
-void opcode16_init(void)
-{
-    opcode_init(opcode16_entries, ENTRY_COUNT, opcode16_handlers, OPCODE_COUNT);
-}
-
 int opcode16_handler(cpu_t *p_cpu)
 {
-    // Check whether opcode16 module was initialized.
-    assert(opcode16_handlers[0] != NULL);
-
-#ifdef DBG_ENABLED
-    if (p_cpu->pc > 0xFF)
-        debug_enabled = 1;
-#endif
-
-    uint8_t opcode;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &opcode);
+    uint8_t opcode = (uint8_t)p_cpu->operand;
 
     return opcode16_handlers[opcode](p_cpu);
 }
 
+opcode_handler_t opcode16_handler_get(uint8_t opcode)
+{
+    return opcode16_handlers[opcode];
+}
+
 /* Private function definitions */
 
-static int opcode16_RLC_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_RLC_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -125,7 +118,6 @@ static int opcode16_RLC_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RLC %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -145,16 +137,13 @@ static int opcode16_RLC_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RLC (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
-static int opcode16_RRC_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_RRC_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -168,7 +157,6 @@ static int opcode16_RRC_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RRC %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -188,16 +176,13 @@ static int opcode16_RRC_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RRC (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
-static int opcode16_RL_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_RL_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -211,7 +196,6 @@ static int opcode16_RL_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RL %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -231,16 +215,13 @@ static int opcode16_RL_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RL (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
-static int opcode16_RR_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_RR_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -254,7 +235,6 @@ static int opcode16_RR_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RR %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -274,17 +254,14 @@ static int opcode16_RR_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:RR (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
 //Shift left into Carry. LSB of n set to 0.
-static int opcode16_SLA_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_SLA_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -298,7 +275,6 @@ static int opcode16_SLA_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:SLA %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -319,17 +295,14 @@ static int opcode16_SLA_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:SLA (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
 //Shift right into Carry. MSB doesn't change.
-static int opcode16_SRA_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_SRA_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -343,7 +316,6 @@ static int opcode16_SRA_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:SRA %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -364,17 +336,14 @@ static int opcode16_SRA_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:SRA (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
 //Swap upper & lower nibles
-static int opcode16_SWAP_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_SWAP_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -387,7 +356,6 @@ static int opcode16_SWAP_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, 0);
 
-    DEBUG_PRINT("%04x:SWAP %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -407,17 +375,14 @@ static int opcode16_SWAP_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, 0);
 
-    DEBUG_PRINT("%04x:SWAP (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
 //Shift right into Carry. MSB set to 0.
-static int opcode16_SRL_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_SRL_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t d;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &d);
-    d &= 0x07;
+    uint8_t d = opcode & 0x07;
 
     uint8_t dv = get_reg3(p_cpu, d);
 
@@ -431,7 +396,6 @@ static int opcode16_SRL_D(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:SRL %s\n", p_cpu->pc, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
@@ -452,17 +416,13 @@ static int opcode16_SRL_HL(cpu_t *p_cpu)
     set_flag_H(p_cpu, 0);
     set_flag_C(p_cpu, flag_c);
 
-    DEBUG_PRINT("%04x:SRL (HL)\n", p_cpu->pc);
     p_cpu->pc += 2;
     return 16;
 }
 
 //Test bit n in register d.
-static int opcode16_BIT_N_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_BIT_N_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t opcode;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &opcode);
-
     uint8_t n = (opcode >> 3) & 0x07;
     uint8_t mask = 1 << n;
 
@@ -473,17 +433,13 @@ static int opcode16_BIT_N_D(cpu_t *p_cpu)
     set_flag_N(p_cpu, 0);
     set_flag_H(p_cpu, 1);
 
-    DEBUG_PRINT("%04x:BIT %02x %s\n", p_cpu->pc, n, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
 
 //Test bit n in register d.
-static int opcode16_BIT_N_HL(cpu_t *p_cpu)
+CPU_INLINE int opcode16_BIT_N_HL(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t opcode;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &opcode);
-
     uint8_t n = (opcode >> 3) & 0x07;
     uint8_t mask = 1 << n;
 
@@ -494,17 +450,13 @@ static int opcode16_BIT_N_HL(cpu_t *p_cpu)
     set_flag_N(p_cpu, 0);
     set_flag_H(p_cpu, 1);
 
-    DEBUG_PRINT("%04x:BIT %02x (HL)\n", p_cpu->pc, n);
     p_cpu->pc += 2;
     return 16;
 }
 
 //Reset bit n in register d.
-static int opcode16_RES_N_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_RES_N_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t opcode;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &opcode);
-
     uint8_t n = (opcode >> 3) & 0x07;
     uint8_t mask = ~(1 << n);
 
@@ -515,17 +467,13 @@ static int opcode16_RES_N_D(cpu_t *p_cpu)
 
     set_reg3(p_cpu, d, dv);
 
-    DEBUG_PRINT("%04x:RES %02x %s\n", p_cpu->pc, n, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
 
 //Reset bit n in register d.
-static int opcode16_RES_N_HL(cpu_t *p_cpu)
+CPU_INLINE int opcode16_RES_N_HL(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t opcode;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &opcode);
-
     uint8_t n = (opcode >> 3) & 0x07;
     uint8_t mask = ~(1 << n);
 
@@ -536,17 +484,13 @@ static int opcode16_RES_N_HL(cpu_t *p_cpu)
 
     (void)mmu_write_u8(p_cpu->p_mmu, p_cpu->reg_HL, value);
 
-    DEBUG_PRINT("%04x:RES %02x (HL)\n", p_cpu->pc, n);
     p_cpu->pc += 2;
     return 16;
 }
 
 //Set bit n in register d.
-static int opcode16_SET_N_D(cpu_t *p_cpu)
+CPU_INLINE int opcode16_SET_N_D(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t opcode;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &opcode);
-
     uint8_t n = (opcode >> 3) & 0x07;
     uint8_t mask = 1 << n;
 
@@ -557,17 +501,13 @@ static int opcode16_SET_N_D(cpu_t *p_cpu)
 
     set_reg3(p_cpu, d, dv);
 
-    DEBUG_PRINT("%04x:SET %02x %s\n", p_cpu->pc, n, str_reg3(d));
     p_cpu->pc += 2;
     return 8;
 }
 
 //Set bit n in register d.
-static int opcode16_SET_N_HL(cpu_t *p_cpu)
+CPU_INLINE int opcode16_SET_N_HL(cpu_t *p_cpu, uint8_t opcode)
 {
-    uint8_t opcode;
-    (void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &opcode);
-
     uint8_t n = (opcode >> 3) & 0x07;
     uint8_t mask = 1 << n;
 
@@ -578,7 +518,6 @@ static int opcode16_SET_N_HL(cpu_t *p_cpu)
 
     (void)mmu_write_u8(p_cpu->p_mmu, p_cpu->reg_HL, value);
 
-    DEBUG_PRINT("%04x:SET %02x (HL)\n", p_cpu->pc, n);
     p_cpu->pc += 2;
     return 16;
 }
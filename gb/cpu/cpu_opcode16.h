@@ -2,9 +2,11 @@
 #define CPU_OPCODE16_H_
 
 #include "cpu_def.h"
-
-void opcode16_init(void);
+#include "cpu_opcode.h"
 
 int opcode16_handler(cpu_t *p_cpu);
 
+/* Specialized handler of a CB prefixed opcode, for the JIT. */
+opcode_handler_t opcode16_handler_get(uint8_t opcode);
+
 #endif /*CPU_OPCODE16_H_*/
\ No newline at end of file
@@ -4,24 +4,14 @@
 #include "cpu_opcode.h"
 #include "cpu_alu.h"
 #include "cpu_registers.h"
-
-#if 0
-#define DBG_ENABLED
-static int debug_enabled = 0;
-
-#define DEBUG_PRINT(fmt, ...) \
-	if (debug_enabled)        \
-	printf(fmt, __VA_ARGS__)
-#else
-#define DEBUG_PRINT(fmt, ...) (void)0
-#endif /*NDEBUG*/
+#include "cpu_irq.h"
+#include "cpu_jit.h"
 
 #include <stdio.h>
 
 /* Defines */
 
 #define OPCODE_COUNT (256)
-#define ENTRY_COUNT (sizeof(opcode8_entries) / sizeof(opcode_entry_t))
 
 /* Typedefs */
 
@@ -29,24 +19,23 @@ static int debug_enabled = 0;
 
 /* Private variables */
 
-opcode_handler_t opcode8_handlers[OPCODE_COUNT] = {NULL};
-
 /* Private function declarations */
 
+static uint8_t opcode8_decode_fetch(cpu_t *p_cpu);
 static int opcode8_UNHANDLED(cpu_t *p_cpu);
 static int opcode8_NOP(cpu_t *p_cpu);
 static int opcode8_LD_N_SP(cpu_t *p_cpu);
-static int opcode8_LD_R_N(cpu_t *p_cpu);
-static int opcode8_ADD_HL_R(cpu_t *p_cpu);
-static int opcode8_LD_R_A(cpu_t *p_cpu);
-static int opcode8_LD_A_R(cpu_t *p_cpu);
-static int opcode8_INC_R(cpu_t *p_cpu);
-static int opcode8_DEC_R(cpu_t *p_cpu);
-static int opcode8_INC_D(cpu_t *p_cpu);
+CPU_INLINE int opcode8_LD_R_N(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_ADD_HL_R(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_LD_R_A(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_LD_A_R(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_INC_R(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_DEC_R(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_INC_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_INC_HL(cpu_t *p_cpu);
-static int opcode8_DEC_D(cpu_t *p_cpu);
+CPU_INLINE int opcode8_DEC_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_DEC_HL(cpu_t *p_cpu);
-static int opcode8_LD_D_N(cpu_t *p_cpu);
+CPU_INLINE int opcode8_LD_D_N(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_LD_HL_N(cpu_t *p_cpu);
 static int opcode8_RLCA(cpu_t *p_cpu);
 static int opcode8_RRCA(cpu_t *p_cpu);
@@ -54,7 +43,7 @@ static int opcode8_RLA(cpu_t *p_cpu);
 static int opcode8_RRA(cpu_t *p_cpu);
 static int opcode8_STOP(cpu_t *p_cpu);
 static int opcode8_JR_N(cpu_t *p_cpu);
-static int opcode8_JR_F_N(cpu_t *p_cpu);
+CPU_INLINE int opcode8_JR_F_N(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_LDI_HL_A(cpu_t *p_cpu);
 static int opcode8_LDI_A_HL(cpu_t *p_cpu);
 static int opcode8_LDD_HL_A(cpu_t *p_cpu);
@@ -63,18 +52,18 @@ static int opcode8_DAA(cpu_t *p_cpu);
 static int opcode8_CPL(cpu_t *p_cpu);
 static int opcode8_SCF(cpu_t *p_cpu);
 static int opcode8_CCF(cpu_t *p_cpu);
-static int opcode8_LD_D_D(cpu_t *p_cpu);
-static int opcode8_LD_D_HL(cpu_t *p_cpu);
-static int opcode8_LD_HL_D(cpu_t *p_cpu);
+CPU_INLINE int opcode8_LD_D_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_LD_D_HL(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_LD_HL_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_HALT(cpu_t *p_cpu);
-static int opcode8_ADD_A_D(cpu_t *p_cpu);
-static int opcode8_ADC_A_D(cpu_t *p_cpu);
-static int opcode8_SUB_A_D(cpu_t *p_cpu);
-static int opcode8_SBC_A_D(cpu_t *p_cpu);
-static int opcode8_AND_A_D(cpu_t *p_cpu);
-static int opcode8_XOR_A_D(cpu_t *p_cpu);
-static int opcode8_OR_A_D(cpu_t *p_cpu);
-static int opcode8_CP_A_D(cpu_t *p_cpu);
+CPU_INLINE int opcode8_ADD_A_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_ADC_A_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_SUB_A_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_SBC_A_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_AND_A_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_XOR_A_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_OR_A_D(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_CP_A_D(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_ADD_A_HL(cpu_t *p_cpu);
 static int opcode8_ADC_A_HL(cpu_t *p_cpu);
 static int opcode8_SUB_A_HL(cpu_t *p_cpu);
@@ -91,16 +80,16 @@ static int opcode8_AND_A_N(cpu_t *p_cpu);
 static int opcode8_XOR_A_N(cpu_t *p_cpu);
 static int opcode8_OR_A_N(cpu_t *p_cpu);
 static int opcode8_CP_A_N(cpu_t *p_cpu);
-static int opcode8_POP_R(cpu_t *p_cpu);
-static int opcode8_PUSH_R(cpu_t *p_cpu);
-static int opcode8_RST_N(cpu_t *p_cpu);
+CPU_INLINE int opcode8_POP_R(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_PUSH_R(cpu_t *p_cpu, uint8_t opcode);
+CPU_INLINE int opcode8_RST_N(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_RET(cpu_t *p_cpu);
 static int opcode8_RET_I(cpu_t *p_cpu);
-static int opcode8_RET_F(cpu_t *p_cpu);
+CPU_INLINE int opcode8_RET_F(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_JP_N(cpu_t *p_cpu);
-static int opcode8_JP_F_N(cpu_t *p_cpu);
+CPU_INLINE int opcode8_JP_F_N(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_CALL_N(cpu_t *p_cpu);
-static int opcode8_CALL_F_N(cpu_t *p_cpu);
+CPU_INLINE int opcode8_CALL_F_N(cpu_t *p_cpu, uint8_t opcode);
 static int opcode8_ADD_SP_N(cpu_t *p_cpu);
 static int opcode8_LD_HL_SP_N(cpu_t *p_cpu);
 static int opcode8_LD_FF00_N_A(cpu_t *p_cpu);
@@ -114,159 +103,522 @@ static int opcode8_LD_SP_HL(cpu_t *p_cpu);
 static int opcode8_DI(cpu_t *p_cpu);
 static int opcode8_EI(cpu_t *p_cpu);
 
-static const opcode_entry_t opcode8_entries[] = {
-	{0xFF, 0x00, opcode8_NOP},		   // NOP
-	{0xFF, 0x07, opcode8_RLCA},		   // RLCA
-	{0xFF, 0x08, opcode8_LD_N_SP},	 // LD (N), SP
-	{0xFF, 0x0F, opcode8_RRCA},		   // RRCA
-	{0xFF, 0x10, opcode8_STOP},		   // STOP
-	{0xFF, 0x17, opcode8_RLA},		   // RLA
-	{0xFF, 0x18, opcode8_JR_N},		   // JR N
-	{0xFF, 0x1F, opcode8_RRA},		   // RRA
-	{0xFF, 0x22, opcode8_LDI_HL_A},	// LDI (HL), A
-	{0xFF, 0x27, opcode8_DAA},		   // DAA
-	{0xFF, 0x2A, opcode8_LDI_A_HL},	// LDI A, (HL)
-	{0xFF, 0x2F, opcode8_CPL},		   // CPL
-	{0xFF, 0x32, opcode8_LDD_HL_A},	// LDD (HL), A
-	{0xFF, 0x34, opcode8_INC_HL},	  // INC (HL)
-	{0xFF, 0x35, opcode8_DEC_HL},	  // DEC (HL)
-	{0xFF, 0x36, opcode8_LD_HL_N},	 // LD (HL), N
-	{0xFF, 0x37, opcode8_SCF},		   // SCF
-	{0xFF, 0x3A, opcode8_LDD_A_HL},	// LDD A, (HL)
-	{0xFF, 0x3F, opcode8_CCF},		   // CCF
-	{0xFF, 0x76, opcode8_HALT},		   // HALT
-	{0xFF, 0x86, opcode8_ADD_A_HL},	// ADD A, (HL)
-	{0xFF, 0x8E, opcode8_ADC_A_HL},	// ADC A, (HL)
-	{0xFF, 0x96, opcode8_SUB_A_HL},	// SUB A, (HL)
-	{0xFF, 0x9E, opcode8_SBC_A_HL},	// SBC A, (HL)
-	{0xFF, 0xA6, opcode8_AND_A_HL},	// AND A, (HL)
-	{0xFF, 0xAE, opcode8_XOR_A_HL},	// XOR A, (HL)
-	{0xFF, 0xB6, opcode8_OR_A_HL},	 // OR A, (HL)
-	{0xFF, 0xBE, opcode8_CP_A_HL},	 // CP A, (HL)
-	{0xFF, 0xC3, opcode8_JP_N},		   // JP N
-	{0xFF, 0xC6, opcode8_ADD_A_N},	 // ADD A, N
-	{0xFF, 0xC9, opcode8_RET},		   // RET
-	{0xFF, 0xCB, opcode16_handler},	// 16bits opcodes
-	{0xFF, 0xCD, opcode8_CALL_N},	  // CALL N
-	{0xFF, 0xCE, opcode8_ADC_A_N},	 // ADC A, N
-	{0xFF, 0xD6, opcode8_SUB_A_N},	 // SUB A, N
-	{0xFF, 0xD9, opcode8_RET_I},	   // RETI
-	{0xFF, 0xDE, opcode8_SBC_A_N},	 // SBC A, N
-	{0xFF, 0xE0, opcode8_LD_FF00_N_A}, // LD (FF00+N), A
-	{0xFF, 0xE2, opcode8_LD_C_A},	  // LD (C), A
-	{0xFF, 0xE6, opcode8_AND_A_N},	 // AND A, N
-	{0xFF, 0xE8, opcode8_ADD_SP_N},	// ADD SP, N
-	{0xFF, 0xE9, opcode8_JP_HL},	   // JP HL
-	{0xFF, 0xEA, opcode8_LD_N_A},	  // LD (N), A
-	{0xFF, 0xEE, opcode8_XOR_A_N},	 // XOR A, N
-	{0xFF, 0xF0, opcode8_LD_A_FF00_N}, // LD A, (FF00+N)
-	{0xFF, 0xF2, opcode8_LD_A_C},	  // LD A, (C)
-	{0xFF, 0xF3, opcode8_DI},		   // DI
-	{0xFF, 0xF6, opcode8_OR_A_N},	  // OR A, N
-	{0xFF, 0xF8, opcode8_LD_HL_SP_N},  // LD HL, SP+N
-	{0xFF, 0xF9, opcode8_LD_SP_HL},	// LD SP, HL
-	{0xFF, 0xFA, opcode8_LD_A_N},	  // LD A, (N)
-	{0xFF, 0xFB, opcode8_EI},		   // EI
-	{0xFF, 0xFE, opcode8_CP_A_N},	  // CP A, N
-	{0xF8, 0x70, opcode8_LD_HL_D},	 // LD (HL), D
-	{0xF8, 0x80, opcode8_ADD_A_D},	 // ADD A, D
-	{0xF8, 0x88, opcode8_ADC_A_D},	 // ADC A, D
-	{0xF8, 0x90, opcode8_SUB_A_D},	 // SUB A, D
-	{0xF8, 0x98, opcode8_SBC_A_D},	 // SBC A, D
-	{0xF8, 0xA0, opcode8_AND_A_D},	 // AND A, D
-	{0xF8, 0xA8, opcode8_XOR_A_D},	 // XOR A, D
-	{0xF8, 0xB0, opcode8_OR_A_D},	  // OR A, D
-	{0xF8, 0xB8, opcode8_CP_A_D},	  // CP A, D
-	{0xEF, 0x02, opcode8_LD_R_A},	  // LD (R), A
-	{0xEF, 0x0A, opcode8_LD_A_R},	  // LD A, (R)
-	{0xE7, 0xC0, opcode8_RET_F},	   // RET F
-	{0xE7, 0xC2, opcode8_JP_F_N},	  // JP F, N
-	{0xE7, 0xC4, opcode8_CALL_F_N},	// CALL F, N
-	{0xE7, 0x20, opcode8_JR_F_N},	  // JR F, N
-	{0xCF, 0x01, opcode8_LD_R_N},	  // LD R, N
-	{0xCF, 0x03, opcode8_INC_R},	   // INC R
-	{0xCF, 0x09, opcode8_ADD_HL_R},	// ADD HL, R
-	{0xCF, 0x0B, opcode8_DEC_R},	   // DEC R
-	{0xCF, 0xC1, opcode8_POP_R},	   // POP R
-	{0xCF, 0xC5, opcode8_PUSH_R},	  // PUSH R
-	{0xC7, 0x04, opcode8_INC_D},	   // INC D
-	{0xC7, 0x05, opcode8_DEC_D},	   // DEC D
-	{0xC7, 0x06, opcode8_LD_D_N},	  // LD D, N
-	{0xC7, 0x46, opcode8_LD_D_HL},	 // LD D, (HL)
-	{0xC7, 0xC7, opcode8_RST_N},	   // RST N
-	{0xC0, 0x40, opcode8_LD_D_D},	  // LD D, D
-	{0x00, 0x00, opcode_UNHANDLED}};
+/* Decoder, entries are matched in order. Called with a constant opcode by
+the handlers below, the matching reduces to the handler call. */
+CPU_INLINE int opcode8_decode(cpu_t *p_cpu, uint8_t opcode)
+{
+	OPCODE_MATCH(0xFF, 0x00, opcode8_NOP(p_cpu));              // NOP
+	OPCODE_MATCH(0xFF, 0x07, opcode8_RLCA(p_cpu));             // RLCA
+	OPCODE_MATCH(0xFF, 0x08, opcode8_LD_N_SP(p_cpu));          // LD (N), SP
+	OPCODE_MATCH(0xFF, 0x0F, opcode8_RRCA(p_cpu));             // RRCA
+	OPCODE_MATCH(0xFF, 0x10, opcode8_STOP(p_cpu));             // STOP
+	OPCODE_MATCH(0xFF, 0x17, opcode8_RLA(p_cpu));              // RLA
+	OPCODE_MATCH(0xFF, 0x18, opcode8_JR_N(p_cpu));             // JR N
+	OPCODE_MATCH(0xFF, 0x1F, opcode8_RRA(p_cpu));              // RRA
+	OPCODE_MATCH(0xFF, 0x22, opcode8_LDI_HL_A(p_cpu));         // LDI (HL), A
+	OPCODE_MATCH(0xFF, 0x27, opcode8_DAA(p_cpu));              // DAA
+	OPCODE_MATCH(0xFF, 0x2A, opcode8_LDI_A_HL(p_cpu));         // LDI A, (HL)
+	OPCODE_MATCH(0xFF, 0x2F, opcode8_CPL(p_cpu));              // CPL
+	OPCODE_MATCH(0xFF, 0x32, opcode8_LDD_HL_A(p_cpu));         // LDD (HL), A
+	OPCODE_MATCH(0xFF, 0x34, opcode8_INC_HL(p_cpu));           // INC (HL)
+	OPCODE_MATCH(0xFF, 0x35, opcode8_DEC_HL(p_cpu));           // DEC (HL)
+	OPCODE_MATCH(0xFF, 0x36, opcode8_LD_HL_N(p_cpu));          // LD (HL), N
+	OPCODE_MATCH(0xFF, 0x37, opcode8_SCF(p_cpu));              // SCF
+	OPCODE_MATCH(0xFF, 0x3A, opcode8_LDD_A_HL(p_cpu));         // LDD A, (HL)
+	OPCODE_MATCH(0xFF, 0x3F, opcode8_CCF(p_cpu));              // CCF
+	OPCODE_MATCH(0xFF, 0x76, opcode8_HALT(p_cpu));             // HALT
+	OPCODE_MATCH(0xFF, 0x86, opcode8_ADD_A_HL(p_cpu));         // ADD A, (HL)
+	OPCODE_MATCH(0xFF, 0x8E, opcode8_ADC_A_HL(p_cpu));         // ADC A, (HL)
+	OPCODE_MATCH(0xFF, 0x96, opcode8_SUB_A_HL(p_cpu));         // SUB A, (HL)
+	OPCODE_MATCH(0xFF, 0x9E, opcode8_SBC_A_HL(p_cpu));         // SBC A, (HL)
+	OPCODE_MATCH(0xFF, 0xA6, opcode8_AND_A_HL(p_cpu));         // AND A, (HL)
+	OPCODE_MATCH(0xFF, 0xAE, opcode8_XOR_A_HL(p_cpu));         // XOR A, (HL)
+	OPCODE_MATCH(0xFF, 0xB6, opcode8_OR_A_HL(p_cpu));          // OR A, (HL)
+	OPCODE_MATCH(0xFF, 0xBE, opcode8_CP_A_HL(p_cpu));          // CP A, (HL)
+	OPCODE_MATCH(0xFF, 0xC3, opcode8_JP_N(p_cpu));             // JP N
+	OPCODE_MATCH(0xFF, 0xC6, opcode8_ADD_A_N(p_cpu));          // ADD A, N
+	OPCODE_MATCH(0xFF, 0xC9, opcode8_RET(p_cpu));              // RET
+	OPCODE_MATCH(0xFF, 0xCB, opcode16_handler(p_cpu));         // 16bits opcodes
+	OPCODE_MATCH(0xFF, 0xCD, opcode8_CALL_N(p_cpu));           // CALL N
+	OPCODE_MATCH(0xFF, 0xCE, opcode8_ADC_A_N(p_cpu));          // ADC A, N
+	OPCODE_MATCH(0xFF, 0xD6, opcode8_SUB_A_N(p_cpu));          // SUB A, N
+	OPCODE_MATCH(0xFF, 0xD9, opcode8_RET_I(p_cpu));            // RETI
+	OPCODE_MATCH(0xFF, 0xDE, opcode8_SBC_A_N(p_cpu));          // SBC A, N
+	OPCODE_MATCH(0xFF, 0xE0, opcode8_LD_FF00_N_A(p_cpu));      // LD (FF00+N), A
+	OPCODE_MATCH(0xFF, 0xE2, opcode8_LD_C_A(p_cpu));           // LD (C), A
+	OPCODE_MATCH(0xFF, 0xE6, opcode8_AND_A_N(p_cpu));          // AND A, N
+	OPCODE_MATCH(0xFF, 0xE8, opcode8_ADD_SP_N(p_cpu));         // ADD SP, N
+	OPCODE_MATCH(0xFF, 0xE9, opcode8_JP_HL(p_cpu));            // JP HL
+	OPCODE_MATCH(0xFF, 0xEA, opcode8_LD_N_A(p_cpu));           // LD (N), A
+	OPCODE_MATCH(0xFF, 0xEE, opcode8_XOR_A_N(p_cpu));          // XOR A, N
+	OPCODE_MATCH(0xFF, 0xF0, opcode8_LD_A_FF00_N(p_cpu));      // LD A, (FF00+N)
+	OPCODE_MATCH(0xFF, 0xF2, opcode8_LD_A_C(p_cpu));           // LD A, (C)
+	OPCODE_MATCH(0xFF, 0xF3, opcode8_DI(p_cpu));               // DI
+	OPCODE_MATCH(0xFF, 0xF6, opcode8_OR_A_N(p_cpu));           // OR A, N
+	OPCODE_MATCH(0xFF, 0xF8, opcode8_LD_HL_SP_N(p_cpu));       // LD HL, SP+N
+	OPCODE_MATCH(0xFF, 0xF9, opcode8_LD_SP_HL(p_cpu));         // LD SP, HL
+	OPCODE_MATCH(0xFF, 0xFA, opcode8_LD_A_N(p_cpu));           // LD A, (N)
+	OPCODE_MATCH(0xFF, 0xFB, opcode8_EI(p_cpu));               // EI
+	OPCODE_MATCH(0xFF, 0xFE, opcode8_CP_A_N(p_cpu));           // CP A, N
+	OPCODE_MATCH(0xF8, 0x70, opcode8_LD_HL_D(p_cpu, opcode));  // LD (HL), D
+	OPCODE_MATCH(0xF8, 0x80, opcode8_ADD_A_D(p_cpu, opcode));  // ADD A, D
+	OPCODE_MATCH(0xF8, 0x88, opcode8_ADC_A_D(p_cpu, opcode));  // ADC A, D
+	OPCODE_MATCH(0xF8, 0x90, opcode8_SUB_A_D(p_cpu, opcode));  // SUB A, D
+	OPCODE_MATCH(0xF8, 0x98, opcode8_SBC_A_D(p_cpu, opcode));  // SBC A, D
+	OPCODE_MATCH(0xF8, 0xA0, opcode8_AND_A_D(p_cpu, opcode));  // AND A, D
+	OPCODE_MATCH(0xF8, 0xA8, opcode8_XOR_A_D(p_cpu, opcode));  // XOR A, D
+	OPCODE_MATCH(0xF8, 0xB0, opcode8_OR_A_D(p_cpu, opcode));   // OR A, D
+	OPCODE_MATCH(0xF8, 0xB8, opcode8_CP_A_D(p_cpu, opcode));   // CP A, D
+	OPCODE_MATCH(0xEF, 0x02, opcode8_LD_R_A(p_cpu, opcode));   // LD (R), A
+	OPCODE_MATCH(0xEF, 0x0A, opcode8_LD_A_R(p_cpu, opcode));   // LD A, (R)
+	OPCODE_MATCH(0xE7, 0xC0, opcode8_RET_F(p_cpu, opcode));    // RET F
+	OPCODE_MATCH(0xE7, 0xC2, opcode8_JP_F_N(p_cpu, opcode));   // JP F, N
+	OPCODE_MATCH(0xE7, 0xC4, opcode8_CALL_F_N(p_cpu, opcode)); // CALL F, N
+	OPCODE_MATCH(0xE7, 0x20, opcode8_JR_F_N(p_cpu, opcode));   // JR F, N
+	OPCODE_MATCH(0xCF, 0x01, opcode8_LD_R_N(p_cpu, opcode));   // LD R, N
+	OPCODE_MATCH(0xCF, 0x03, opcode8_INC_R(p_cpu, opcode));    // INC R
+	OPCODE_MATCH(0xCF, 0x09, opcode8_ADD_HL_R(p_cpu, opcode)); // ADD HL, R
+	OPCODE_MATCH(0xCF, 0x0B, opcode8_DEC_R(p_cpu, opcode));    // DEC R
+	OPCODE_MATCH(0xCF, 0xC1, opcode8_POP_R(p_cpu, opcode));    // POP R
+	OPCODE_MATCH(0xCF, 0xC5, opcode8_PUSH_R(p_cpu, opcode));   // PUSH R
+	OPCODE_MATCH(0xC7, 0x04, opcode8_INC_D(p_cpu, opcode));    // INC D
+	OPCODE_MATCH(0xC7, 0x05, opcode8_DEC_D(p_cpu, opcode));    // DEC D
+	OPCODE_MATCH(0xC7, 0x06, opcode8_LD_D_N(p_cpu, opcode));   // LD D, N
+	OPCODE_MATCH(0xC7, 0x46, opcode8_LD_D_HL(p_cpu, opcode));  // LD D, (HL)
+	OPCODE_MATCH(0xC7, 0xC7, opcode8_RST_N(p_cpu, opcode));    // RST N
+	OPCODE_MATCH(0xC0, 0x40, opcode8_LD_D_D(p_cpu, opcode));   // LD D, D
+
+	return opcode_UNHANDLED(p_cpu);
+}
+
+#define OPCODE8_HANDLER(opcode)                \
+	static int opcode8_##opcode(cpu_t *p_cpu) \
+	{                                          \
+		CPU_STATS_OPCODE(p_cpu, opcode);       \
+		return opcode8_decode(p_cpu, opcode);  \
+	}
+
+OPCODE_TABLE(OPCODE8_HANDLER)
+
+#define OPCODE8_ENTRY(opcode) opcode8_##opcode,
+
+static const opcode_handler_t opcode8_handlers[OPCODE_COUNT] = {OPCODE_TABLE(OPCODE8_ENTRY)};
+
+/* Instruction length, from the opcode alone (CB prefixed ones take 2). */
+#define OPCODE8_LENGTH(opcode)                                                                          \
+	(((((opcode)&0xCF) == 0x01) || ((opcode) == 0x08) || (((opcode)&0xE7) == 0xC2) ||                  \
+	  ((opcode) == 0xC3) || (((opcode)&0xE7) == 0xC4) || ((opcode) == 0xCD) || ((opcode) == 0xEA) ||  \
+	  ((opcode) == 0xFA))                                                                               \
+		 ? 3                                                                                            \
+		 : (((((opcode)&0xC7) == 0x06) || ((opcode) == 0x18) || (((opcode)&0xE7) == 0x20) ||           \
+			 (((opcode)&0xC7) == 0xC6) || ((opcode) == 0xCB) || ((opcode) == 0xE0) || ((opcode) == 0xE8) || \
+			 ((opcode) == 0xF0) || ((opcode) == 0xF8))                                                  \
+				? 2                                                                                     \
+				: 1))
+
+#define OPCODE8_LENGTH_ENTRY(opcode) OPCODE8_LENGTH(opcode),
+
+static const uint8_t opcode8_lengths[OPCODE_COUNT] = {OPCODE_TABLE(OPCODE8_LENGTH_ENTRY)};
+
+/* Superinstructions, pairs of ROM instructions run from a single dispatch,
+picked from the pair counts of CPU_STATS builds (see cpu_stats_report). Loops
+dominate them: polling (LD A, (FF00+n) then CP / AND, the compare then JR),
+block copies (LD A, (HL+), LD (DE), A, INC DE) and countdowns (DEC r, JR NZ).
+Each instruction has a byte of operand at most, the pair's operands are kept
+in the cache entry, first in the low byte. */
+#define OPCODE8_FUSED_TABLE(X)                                                                        \
+	X(0, 0xF0, 0xFE) /* LD A, (FF00+n); CP n */                                                       \
+	X(1, 0xF0, 0xE6) /* LD A, (FF00+n); AND n */                                                      \
+	X(2, 0xFE, 0x20) /* CP n; JR NZ */                                                                \
+	X(3, 0xFE, 0x28) /* CP n; JR Z */                                                                 \
+	X(4, 0xE6, 0x20) /* AND n; JR NZ */                                                               \
+	X(5, 0xE6, 0x28) /* AND n; JR Z */                                                                \
+	X(6, 0x2A, 0x12) /* LD A, (HL+); LD (DE), A */                                                    \
+	X(7, 0x12, 0x13) /* LD (DE), A; INC DE */                                                         \
+	X(8, 0x05, 0x20) /* DEC B; JR NZ */                                                               \
+	X(9, 0x0D, 0x20) /* DEC C; JR NZ */                                                               \
+	X(10, 0x15, 0x20) /* DEC D; JR NZ */                                                              \
+	X(11, 0x1D, 0x20) /* DEC E; JR NZ */                                                              \
+	X(12, 0x3D, 0x20) /* DEC A; JR NZ */                                                              \
+	X(13, 0x0B, 0x78) /* DEC BC; LD A, B */                                                           \
+	X(14, 0x78, 0xB1) /* LD A, B; OR C */
+
+#define OPCODE8_FUSED_COUNT (15)
+
+/* The second instruction runs only if the first did not reach the deadline,
+as between two dispatches. IRQs may not become pending in between: IF and IE
+change through IO writes, which stop the CPU batch. Returns the cycles of the
+second instruction, those of the first are already on the clock. */
+CPU_INLINE int opcode8_fused(cpu_t *p_cpu, opcode_handler_t first, opcode_handler_t second)
+{
+	mmu_t *p_mmu = p_cpu->p_mmu;
+	uint16_t operands = p_cpu->operand;
+
+	p_cpu->operand = operands & 0x00FF;
+	mmu_advance(p_mmu, first(p_cpu));
+
+	if (p_mmu->clock >= p_cpu->run_until)
+		return 0;
+
+	p_cpu->operand = operands >> 8;
+	return second(p_cpu);
+}
+
+#define OPCODE8_FUSED_HANDLER(index, first, second)                      \
+	static int opcode8_fused_##index(cpu_t *p_cpu)                      \
+	{                                                                   \
+		return opcode8_fused(p_cpu, opcode8_##first, opcode8_##second); \
+	}
+
+OPCODE8_FUSED_TABLE(OPCODE8_FUSED_HANDLER)
+
+#define OPCODE8_FUSED_FIRST(index, first, second) [index] = (first),
+#define OPCODE8_FUSED_SECOND(index, first, second) [index] = (second),
+
+static const uint8_t opcode8_fused_first[OPCODE8_FUSED_COUNT] = {OPCODE8_FUSED_TABLE(OPCODE8_FUSED_FIRST)};
+#ifndef MMU_PROFILE
+static const uint8_t opcode8_fused_second[OPCODE8_FUSED_COUNT] = {OPCODE8_FUSED_TABLE(OPCODE8_FUSED_SECOND)};
+#endif
 
 /* Inlined private function definitions */
 
-/* Public function definitions */
+/* Code dirty bits of the chunks holding an instruction. */
+static inline uint64_t opcode8_code_mask(uint16_t address, int length)
+{
+	uint16_t offset = MMU_PAGE_OFFSET(address);
+
+	return (MMU_DIRTY_MARK(offset) | MMU_DIRTY_MARK(offset + length - 1)) & (0x1111111111111111ull << MMU_DIRTY_CODE);
+}
 
-void opcode8_init(void)
+/* Fetch the instruction at pc, returns its opcode (or the fused pair starting
+there) and leaves its immediate operand in p_cpu->operand. Hits need the page
+read in place with the same host memory, RAM ones also no write to the chunks
+holding them since they were decoded. Trapped pages are never read in place,
+watchpoints still see every fetch. */
+CPU_INLINE uint16_t opcode8_fetch(cpu_t *p_cpu)
 {
-	opcode_init(opcode8_entries, ENTRY_COUNT, opcode8_handlers, OPCODE_COUNT);
-	opcode16_init();
+	mmu_t *p_mmu = p_cpu->p_mmu;
+	uint16_t pc = p_cpu->pc;
+	const page_t *p_page = &p_mmu->p_pages[MMU_PAGE_INDEX(pc)];
+	cpu_icache_entry_t *p_entry = &p_cpu->icache[pc & CPU_ICACHE_MASK];
+
+	if (p_page->read_mem && (p_entry->tag == &p_page->read_mem[MMU_PAGE_OFFSET(pc)]) &&
+		((MMU_PAGE_INDEX(pc) < MMU_DIRTY_FIRST_PAGE) || !(*p_page->dirty & opcode8_code_mask(pc, p_entry->length))))
+	{
+#ifdef MMU_PROFILE
+		for (int i = 0; i < p_entry->length; i++)
+		{
+			MMU_PROFILE_ACCESS(p_mmu, MMU_PROFILE_FETCH, pc + i);
+		}
+#endif
+		p_cpu->operand = p_entry->operand;
+		return p_entry->opcode;
+	}
+
+	return opcode8_decode_fetch(p_cpu);
 }
 
+/* Public function definitions */
+
 int opcode8_handler(cpu_t *p_cpu)
 {
-	// Check whether opcode16 module was initialized.
-	assert(opcode8_handlers[0] != NULL);
+	uint16_t opcode = opcode8_fetch(p_cpu);
 
-#ifdef DBG_ENABLED
-	if (p_cpu->pc > 0xFF)
-		debug_enabled = 1;
+	/* One instruction at a time here. */
+	if (opcode >= OPCODE_COUNT)
+	{
+		opcode = opcode8_fused_first[opcode - OPCODE_COUNT];
+		p_cpu->operand &= 0x00FF;
+	}
+
+	return opcode8_handlers[opcode](p_cpu);
+}
+
+opcode_handler_t opcode8_handler_get(uint8_t opcode)
+{
+	return opcode8_handlers[opcode];
+}
+
+int opcode8_length(uint8_t opcode)
+{
+	return opcode8_lengths[opcode];
+}
+
+int opcode8_legal(uint8_t opcode)
+{
+	switch (opcode)
+	{
+	case 0xD3:
+	case 0xDB:
+	case 0xDD:
+	case 0xE3:
+	case 0xE4:
+	case 0xEB:
+	case 0xEC:
+	case 0xED:
+	case 0xF4:
+	case 0xFC:
+	case 0xFD:
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+/* Run instructions back to back until the MMU clock reaches p_cpu->run_until.
+Dispatch is threaded through computed gotos with GCC / Clang, a switch
+otherwise. Handlers are static so they get inlined in the loop. */
+#if defined(__GNUC__) && !defined(OPCODE8_NO_THREADED_DISPATCH)
+#define OPCODE8_THREADED_DISPATCH
 #endif
 
-	uint8_t opcode;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &opcode);
+static inline int opcode8_irq_pending(cpu_t *p_cpu)
+{
+	return p_cpu->ei_counter || p_cpu->di_counter || p_cpu->halted ||
+		   (p_cpu->irq_master_enable && (mmu_io_get(p_cpu->p_mmu, IF_REG_ADDR) & mmu_io_get(p_cpu->p_mmu, IE_REG_ADDR) & 0x1F));
+}
 
-	return opcode8_handlers[opcode](p_cpu);
+/* A halted CPU only wakes up on an IRQ, raised by the timer or PPU at a batch
+boundary at the earliest: skip to run_until in whole 4 cycle steps. */
+static inline int opcode8_halt_cycles(cpu_t *p_cpu)
+{
+	uint64_t clock = p_cpu->p_mmu->clock;
+
+	if (p_cpu->ei_counter || p_cpu->di_counter || (p_cpu->run_until <= (clock + 4)))
+		return 4;
+
+	return (int)((p_cpu->run_until - clock + 3) & ~(uint64_t)3);
+}
+
+void opcode8_run(cpu_t *p_cpu)
+{
+	mmu_t *p_mmu = p_cpu->p_mmu;
+	int cycles;
+
+#ifdef OPCODE8_THREADED_DISPATCH
+#define OPCODE8_LABEL(opcode) &&label_##opcode,
+#define OPCODE8_FUSED_LABEL(index, first, second) &&label_fused_##index,
+	static const void *const labels[OPCODE_COUNT + OPCODE8_FUSED_COUNT] = {OPCODE_TABLE(OPCODE8_LABEL) OPCODE8_FUSED_TABLE(OPCODE8_FUSED_LABEL)};
+
+#ifdef CPU_JIT_ENABLED
+#define OPCODE8_DISPATCH() goto dispatch
+#else
+#define OPCODE8_DISPATCH() goto *labels[opcode8_fetch(p_cpu)]
+#endif
+
+#define OPCODE8_NEXT()                          \
+	mmu_advance(p_mmu, cycles);                 \
+	if (p_mmu->clock >= p_cpu->run_until)       \
+		return;                                 \
+	if (opcode8_irq_pending(p_cpu))             \
+		goto irq;                               \
+	OPCODE8_DISPATCH()
+
+#define OPCODE8_CASE(opcode)          \
+	label_##opcode:                   \
+	cycles = opcode8_##opcode(p_cpu); \
+	OPCODE8_NEXT();
+
+#define OPCODE8_FUSED_CASE(index, first, second) \
+	label_fused_##index:                         \
+	cycles = opcode8_fused_##index(p_cpu);       \
+	OPCODE8_NEXT();
+
+	if (!opcode8_irq_pending(p_cpu))
+	{
+		OPCODE8_DISPATCH();
+	}
+
+irq:
+	cpu_irq_process(p_cpu);
+	if (p_cpu->halted)
+	{
+		cycles = opcode8_halt_cycles(p_cpu);
+		OPCODE8_NEXT();
+	}
+	OPCODE8_DISPATCH();
+
+#ifdef CPU_JIT_ENABLED
+	/* Translated blocks first, they return with the clock advanced. */
+dispatch:
+	if (p_cpu->jit && cpu_jit_execute(p_cpu))
+	{
+		if (p_mmu->clock >= p_cpu->run_until)
+			return;
+		if (opcode8_irq_pending(p_cpu))
+			goto irq;
+		goto dispatch;
+	}
+	goto *labels[opcode8_fetch(p_cpu)];
+#endif
+
+	OPCODE_TABLE(OPCODE8_CASE)
+	OPCODE8_FUSED_TABLE(OPCODE8_FUSED_CASE)
+
+#else
+#define OPCODE8_CASE(opcode)              \
+	case opcode:                          \
+		cycles = opcode8_##opcode(p_cpu); \
+		break;
+
+#define OPCODE8_FUSED_CASE(index, first, second) \
+	case OPCODE_COUNT + index:                   \
+		cycles = opcode8_fused_##index(p_cpu);   \
+		break;
+
+	do
+	{
+		if (opcode8_irq_pending(p_cpu))
+		{
+			cpu_irq_process(p_cpu);
+		}
+
+#ifdef CPU_JIT_ENABLED
+		if (!p_cpu->halted && p_cpu->jit && cpu_jit_execute(p_cpu))
+			continue;
+#endif
+
+		if (p_cpu->halted)
+		{
+			cycles = opcode8_halt_cycles(p_cpu);
+		}
+		else
+		{
+			switch (opcode8_fetch(p_cpu))
+			{
+				OPCODE_TABLE(OPCODE8_CASE)
+				OPCODE8_FUSED_TABLE(OPCODE8_FUSED_CASE)
+			}
+		}
+
+		mmu_advance(p_mmu, cycles);
+	} while (p_mmu->clock < p_cpu->run_until);
+#endif
 }
 
 /* Private function definitions */
 
+/* Instruction cache miss, fetch from memory and keep the decoded instruction
+when it can be checked for changes: ROM, or VRAM / WRAM which are dirty
+tracked. Echo RAM shares its dirty bits with WRAM and is not kept, nor are
+instructions crossing a page. */
+static uint8_t opcode8_decode_fetch(cpu_t *p_cpu)
+{
+	mmu_t *p_mmu = p_cpu->p_mmu;
+	uint16_t pc = p_cpu->pc;
+
+	uint8_t opcode = mmu_fetch_u8(p_mmu, pc);
+	uint8_t length = opcode8_lengths[opcode];
+
+	if (length == 2)
+	{
+		p_cpu->operand = mmu_fetch_operand_u8(p_mmu, pc + 1);
+	}
+	else if (length == 3)
+	{
+		p_cpu->operand = mmu_fetch_operand_u16(p_mmu, pc + 1);
+	}
+
+	int page = MMU_PAGE_INDEX(pc);
+	const page_t *p_page = &p_mmu->p_pages[page];
+
+	if (!p_page->read_mem || ((MMU_PAGE_OFFSET(pc) + length) > MMU_PAGE_SIZE))
+		return opcode;
+
+	if (page >= MMU_DIRTY_FIRST_PAGE)
+	{
+		if ((page >= MMU_PAGE_INDEX(0xE000)) || (p_page->dirty == &p_mmu->dirty_sink))
+			return opcode;
+
+		/* Written chunks, drop every instruction overlapping them before
+		clearing their code bits. */
+		uint64_t dirty = *p_page->dirty & opcode8_code_mask(pc, length);
+		for (uint16_t chunk = pc & ~(MMU_DIRTY_CHUNK_SIZE - 1); dirty; chunk += MMU_DIRTY_CHUNK_SIZE)
+		{
+			uint64_t mask = opcode8_code_mask(chunk, 1);
+			if (dirty & mask)
+			{
+				for (uint16_t address = chunk - 2; address != (uint16_t)(chunk + MMU_DIRTY_CHUNK_SIZE); address++)
+				{
+					p_cpu->icache[address & CPU_ICACHE_MASK].tag = NULL;
+				}
+
+				*p_page->dirty &= ~mask;
+				dirty &= ~mask;
+			}
+		}
+	}
+
+	cpu_icache_entry_t *p_entry = &p_cpu->icache[pc & CPU_ICACHE_MASK];
+	p_entry->tag = &p_page->read_mem[MMU_PAGE_OFFSET(pc)];
+	p_entry->operand = p_cpu->operand;
+	p_entry->opcode = opcode;
+	p_entry->length = length;
+
+#ifndef MMU_PROFILE
+	/* Pairs are fused in ROM only, RAM entries have to follow writes to each
+	of their instructions. Read in place, the second instruction has to fit in
+	the page as well. */
+	if (page < MMU_DIRTY_FIRST_PAGE)
+	{
+		uint16_t offset = MMU_PAGE_OFFSET(pc) + length;
+
+		if (offset < MMU_PAGE_SIZE)
+		{
+			uint8_t second = p_page->read_mem[offset];
+			uint8_t second_length = opcode8_lengths[second];
+
+			for (int index = 0; index < OPCODE8_FUSED_COUNT; index++)
+			{
+				if ((opcode8_fused_first[index] == opcode) && (opcode8_fused_second[index] == second) &&
+					((offset + second_length) <= MMU_PAGE_SIZE))
+				{
+					p_entry->opcode = OPCODE_COUNT + index;
+					p_entry->length = length + second_length;
+					p_entry->operand = (uint16_t)((p_cpu->operand & 0x00FF) |
+												  ((second_length == 2) ? (p_page->read_mem[offset + 1] << 8) : 0));
+					break;
+				}
+			}
+		}
+	}
+#endif
+
+	return opcode;
+}
+
 //No operation.
 static int opcode8_NOP(cpu_t *p_cpu)
 {
-	DEBUG_PRINT("%04x:NOP\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
 
 static int opcode8_LD_N_SP(cpu_t *p_cpu)
 {
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
 	(void)mmu_write_u16(p_cpu->p_mmu, n, p_cpu->sp);
 
-	DEBUG_PRINT("%04x:LD (%04x) SP [%04x]\n", p_cpu->pc, n, p_cpu->sp);
 	p_cpu->pc += 3;
 	return 20;
 }
 
-static int opcode8_LD_R_N(cpu_t *p_cpu)
+CPU_INLINE int opcode8_LD_R_N(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r = (r >> 4) & 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
 	set_reg2(p_cpu, r, n);
 
-	DEBUG_PRINT("%04x:LD %s %04x\n", p_cpu->pc, str_reg2(r), n);
 	p_cpu->pc += 3;
 	return 12;
 }
 
-static int opcode8_ADD_HL_R(cpu_t *p_cpu)
+CPU_INLINE int opcode8_ADD_HL_R(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r >>= 4;
-	r &= 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
 	uint16_t rv = get_reg2(p_cpu, r);
 	uint32_t sum = p_cpu->reg_HL + rv;
@@ -277,81 +629,61 @@ static int opcode8_ADD_HL_R(cpu_t *p_cpu)
 
 	p_cpu->reg_HL = sum;
 
-	DEBUG_PRINT("%04x:ADD HL %s [%04x]\n", p_cpu->pc, str_reg2(r), rv);
 	p_cpu->pc += 1;
 	return 8;
 }
 
-static int opcode8_LD_R_A(cpu_t *p_cpu)
+CPU_INLINE int opcode8_LD_R_A(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r >>= 4;
-	r &= 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
 	uint16_t rv = get_reg2(p_cpu, r);
-	uint8_t a = get_msb(p_cpu->reg_AF);
+	uint8_t a = get_reg3(p_cpu, REG3_A);
 
 	(void)mmu_write_u8(p_cpu->p_mmu, rv, a);
 
-	DEBUG_PRINT("%04x:LD (%s) [%04x] A [%02x]\n", p_cpu->pc, str_reg2(r), rv, a);
 	p_cpu->pc += 1;
 	return 8;
 }
 
-static int opcode8_LD_A_R(cpu_t *p_cpu)
+CPU_INLINE int opcode8_LD_A_R(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r >>= 4;
-	r &= 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
 	uint16_t rv = get_reg2(p_cpu, r);
 
 	uint8_t a;
 	(void)mmu_read_u8(p_cpu->p_mmu, rv, &a);
 
-	set_msb(&(p_cpu->reg_AF), a);
+	set_reg3(p_cpu, REG3_A, a);
 
-	DEBUG_PRINT("%04x:LD A (%s) [%04x:%02x]\n", p_cpu->pc, str_reg2(r), rv, a);
 	p_cpu->pc += 1;
 	return 8;
 }
 
-static int opcode8_INC_R(cpu_t *p_cpu)
+CPU_INLINE int opcode8_INC_R(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r >>= 4;
-	r &= 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
 	set_reg2(p_cpu, r, get_reg2(p_cpu, r) + 1);
 
-	DEBUG_PRINT("%04x:INC %s\n", p_cpu->pc, str_reg2(r));
 	p_cpu->pc += 1;
 	return 8;
 }
 
-static int opcode8_DEC_R(cpu_t *p_cpu)
+CPU_INLINE int opcode8_DEC_R(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r >>= 4;
-	r &= 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
 	set_reg2(p_cpu, r, get_reg2(p_cpu, r) - 1);
 
-	DEBUG_PRINT("%04x:DEC %s\n", p_cpu->pc, str_reg2(r));
 	p_cpu->pc += 1;
 	return 8;
 }
 
-static int opcode8_INC_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_INC_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d >>= 3;
-	d &= 0x07;
+	uint8_t d = (opcode >> 3) & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
@@ -363,7 +695,6 @@ static int opcode8_INC_D(cpu_t *p_cpu)
 	set_flag_N(p_cpu, 0);
 	set_flag_H(p_cpu, (0 == (dv & 0x0F)));
 
-	DEBUG_PRINT("%04x:INC %s\n", p_cpu->pc, str_reg3(d));
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -381,17 +712,13 @@ static int opcode8_INC_HL(cpu_t *p_cpu)
 	set_flag_N(p_cpu, 0);
 	set_flag_H(p_cpu, (0 == (value & 0x0F)));
 
-	DEBUG_PRINT("%04x:INC (HL)\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 12;
 }
 
-static int opcode8_DEC_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_DEC_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d >>= 3;
-	d &= 0x07;
+	uint8_t d = (opcode >> 3) & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
@@ -403,7 +730,6 @@ static int opcode8_DEC_D(cpu_t *p_cpu)
 	set_flag_N(p_cpu, 1);
 	set_flag_H(p_cpu, (0x0F == (dv & 0x0F)));
 
-	DEBUG_PRINT("%04x:DEC %s\n", p_cpu->pc, str_reg3(d));
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -421,108 +747,96 @@ static int opcode8_DEC_HL(cpu_t *p_cpu)
 	set_flag_N(p_cpu, 1);
 	set_flag_H(p_cpu, (0x0F == (value & 0x0F)));
 
-	DEBUG_PRINT("%04x:DEC (HL)\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 12;
 }
 
-static int opcode8_LD_D_N(cpu_t *p_cpu)
+CPU_INLINE int opcode8_LD_D_N(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d >>= 3;
-	d &= 0x07;
+	uint8_t d = (opcode >> 3) & 0x07;
 
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	set_reg3(p_cpu, d, n);
 
-	DEBUG_PRINT("%04x:LD %s %02x\n", p_cpu->pc, str_reg3(d), n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_LD_HL_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	(void)mmu_write_u8(p_cpu->p_mmu, p_cpu->reg_HL, n);
 
-	DEBUG_PRINT("%04x:LD (HL) %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 12;
 }
 
 static int opcode8_RLCA(cpu_t *p_cpu)
 {
-	uint8_t reg_a = get_msb(p_cpu->reg_AF);
+	uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 	uint8_t flag_c = (reg_a >> 7) & 0x01;
 	reg_a = (reg_a << 1) | flag_c;
 
-	set_msb(&(p_cpu->reg_AF), reg_a);
+	set_reg3(p_cpu, REG3_A, reg_a);
 
 	set_flag_Z(p_cpu, 0);
 	set_flag_N(p_cpu, 0);
 	set_flag_H(p_cpu, 0);
 	set_flag_C(p_cpu, flag_c);
 
-	DEBUG_PRINT("%04x:RLCA\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
 
 static int opcode8_RRCA(cpu_t *p_cpu)
 {
-	uint8_t reg_a = get_msb(p_cpu->reg_AF);
+	uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 	uint8_t flag_c = reg_a & 0x01;
 	reg_a = (reg_a >> 1) | (flag_c << 7);
 
-	set_msb(&(p_cpu->reg_AF), reg_a);
+	set_reg3(p_cpu, REG3_A, reg_a);
 
 	set_flag_Z(p_cpu, 0);
 	set_flag_N(p_cpu, 0);
 	set_flag_H(p_cpu, 0);
 	set_flag_C(p_cpu, flag_c);
 
-	DEBUG_PRINT("%04x:RCCA\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
 
 static int opcode8_RLA(cpu_t *p_cpu)
 {
-	uint8_t reg_a = get_msb(p_cpu->reg_AF);
+	uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 	uint8_t flag_c = (reg_a >> 7) & 0x01;
 	reg_a = (reg_a << 1) | get_flag_C(p_cpu);
 
-	set_msb(&(p_cpu->reg_AF), reg_a);
+	set_reg3(p_cpu, REG3_A, reg_a);
 
 	set_flag_Z(p_cpu, 0);
 	set_flag_N(p_cpu, 0);
 	set_flag_H(p_cpu, 0);
 	set_flag_C(p_cpu, flag_c);
 
-	DEBUG_PRINT("%04x:RLA\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
 
 static int opcode8_RRA(cpu_t *p_cpu)
 {
-	uint8_t reg_a = get_msb(p_cpu->reg_AF);
+	uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 	uint8_t flag_c = reg_a & 0x01;
 	reg_a = (reg_a >> 1) | (get_flag_C(p_cpu) << 7);
 
-	set_msb(&(p_cpu->reg_AF), reg_a);
+	set_reg3(p_cpu, REG3_A, reg_a);
 
 	set_flag_Z(p_cpu, 0);
 	set_flag_N(p_cpu, 0);
 	set_flag_H(p_cpu, 0);
 	set_flag_C(p_cpu, flag_c);
 
-	DEBUG_PRINT("%04x:RRA\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -530,7 +844,6 @@ static int opcode8_RRA(cpu_t *p_cpu)
 //Halt CPU & LCD display until button pressed.
 static int opcode8_STOP(cpu_t *p_cpu)
 {
-	DEBUG_PRINT("%04x:STOP\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -538,50 +851,93 @@ static int opcode8_STOP(cpu_t *p_cpu)
 //Add n to current address and jump to it.
 static int opcode8_JR_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	uint16_t newPC = p_cpu->pc + 2 + (int8_t)n;
 
-	DEBUG_PRINT("%04x:JR %04x\n", p_cpu->pc, newPC);
 	p_cpu->pc = newPC;
-	return 8;
+	return 12;
+}
+
+/* Polling loop, back to loop with the JR just taken:
+	LD A, (FF00+n)              12 cycles
+	CP n, AND n or BIT b, A     8 cycles
+	JR cc, loop                 12 cycles
+It sets A and the flags only, to the same values on each iteration as long as
+the polled register does not change. Nothing visible changes before the end of
+the batch: if the previous iteration ran in the batch, without an interrupt in
+between (its read was exactly 32 cycles ago), the next iterations are skipped.
+Returns their cycles, the interpreter would stop after the same JR. Watched
+and traced loops run every iteration, each access or instruction is seen. */
+static int opcode8_busy_wait(cpu_t *p_cpu, uint16_t loop)
+{
+#ifdef MMU_PROFILE
+	/* Reads are counted. */
+	(void)p_cpu;
+	(void)loop;
+	return 0;
+#else
+	mmu_t *p_mmu = p_cpu->p_mmu;
+	uint64_t head = p_mmu->clock + 12;
+
+	if (p_cpu->ei_counter || p_cpu->di_counter || p_mmu->watch.count || p_cpu->trace || (p_cpu->poll_clock != (head - 32)) ||
+		(p_cpu->poll_clock < p_cpu->run_start) ||
+		((head + 20) >= p_cpu->run_until) || (MMU_PAGE_OFFSET(loop) > (MMU_PAGE_SIZE - 6)))
+		return 0;
+
+	const uint8_t *mem = p_mmu->p_pages[MMU_PAGE_INDEX(loop)].read_mem;
+	if (!mem)
+		return 0;
+	mem += MMU_PAGE_OFFSET(loop);
+
+	/* JOYP, IF, LCD registers, HRAM and IE. Not timer nor sound registers, they
+	change between batch boundaries. */
+	uint8_t n = mem[1];
+	if ((mem[0] != 0xF0) || !((n == 0x00) || (n == 0x0F) || ((n >= 0x40) && (n <= 0x4B)) || (n >= 0x80)))
+		return 0;
+
+	if ((mem[2] != 0xFE) && (mem[2] != 0xE6) && !((mem[2] == 0xCB) && ((mem[3] & 0xC7) == 0x47)))
+		return 0;
+
+	/* Whole iterations whose LD and CP complete before run_until. */
+	int iterations = (int)((p_cpu->run_until - head - 21) / 32) + 1;
+	p_cpu->busy_wait_cycles += (uint64_t)iterations * 32;
+
+	return iterations * 32;
+#endif
 }
 
 //If following condition is true then add n to current address and jump to it.
-static int opcode8_JR_F_N(cpu_t *p_cpu)
+CPU_INLINE int opcode8_JR_F_N(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t m;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &m);
-	m >>= 3;
-	m &= 0x03;
+	uint8_t m = (opcode >> 3) & 0x03;
 
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	uint16_t newPC = p_cpu->pc + 2 + (int8_t)n;
 
-	DEBUG_PRINT("%04x:JR %s[%01x] %04x\n", p_cpu->pc, str_mnemonic(m), get_lsb(p_cpu->reg_AF), newPC);
 	if (get_mnemonic(p_cpu, m))
 	{
 		p_cpu->pc = newPC;
+
+		if ((int8_t)n == -6)
+			return 12 + opcode8_busy_wait(p_cpu, newPC);
+
+		return 12;
 	}
-	else
-	{
-		p_cpu->pc += 2;
-	}
+
+	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_LDI_HL_A(cpu_t *p_cpu)
 {
-	uint8_t a = get_msb(p_cpu->reg_AF);
+	uint8_t a = get_reg3(p_cpu, REG3_A);
 
 	(void)mmu_write_u8(p_cpu->p_mmu, p_cpu->reg_HL, a);
 
 	p_cpu->reg_HL += 1;
 
-	DEBUG_PRINT("%04x:LDI (HL) A [%02x]\n", p_cpu->pc, a);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -593,22 +949,20 @@ static int opcode8_LDI_A_HL(cpu_t *p_cpu)
 
 	p_cpu->reg_HL += 1;
 
-	set_msb(&(p_cpu->reg_AF), a);
+	set_reg3(p_cpu, REG3_A, a);
 
-	DEBUG_PRINT("%04x:LDI A (HL) [%02x]\n", p_cpu->pc, a);
 	p_cpu->pc += 1;
 	return 8;
 }
 
 static int opcode8_LDD_HL_A(cpu_t *p_cpu)
 {
-	uint8_t a = get_msb(p_cpu->reg_AF);
+	uint8_t a = get_reg3(p_cpu, REG3_A);
 
 	(void)mmu_write_u8(p_cpu->p_mmu, p_cpu->reg_HL, a);
 
 	p_cpu->reg_HL -= 1;
 
-	DEBUG_PRINT("%04x:LDD (HL) A [%02x]\n", p_cpu->pc, a);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -620,9 +974,8 @@ static int opcode8_LDD_A_HL(cpu_t *p_cpu)
 
 	p_cpu->reg_HL -= 1;
 
-	set_msb(&(p_cpu->reg_AF), a);
+	set_reg3(p_cpu, REG3_A, a);
 
-	DEBUG_PRINT("%04x:LDD A (HL) [%02x]\n", p_cpu->pc, a);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -631,7 +984,7 @@ static int opcode8_LDD_A_HL(cpu_t *p_cpu)
 //correct representation of Binary Coded Decimal (BCD) is obtained.
 static int opcode8_DAA(cpu_t *p_cpu)
 {
-	uint8_t reg_a = get_msb(p_cpu->reg_AF);
+	uint8_t reg_a = get_reg3(p_cpu, REG3_A);
 
 	if (!get_flag_N(p_cpu))
 	{
@@ -659,13 +1012,12 @@ static int opcode8_DAA(cpu_t *p_cpu)
 		}
 	}
 
-	set_msb(&p_cpu->reg_AF, reg_a);
+	set_reg3(p_cpu, REG3_A, reg_a);
 
 	/* Update z and h flags. */
 	set_flag_Z(p_cpu, (reg_a == 0));
 	set_flag_H(p_cpu, 0);
 
-	DEBUG_PRINT("%04x:DAA\n", p_cpu->pc, get_msb(p_cpu->reg_AF), reg_a);
 	p_cpu->pc += 1;
 
 	return 4;
@@ -674,13 +1026,12 @@ static int opcode8_DAA(cpu_t *p_cpu)
 //Complement A register. (Flip all bits.)
 static int opcode8_CPL(cpu_t *p_cpu)
 {
-	uint8_t reg_a = ~get_msb(p_cpu->reg_AF);
-	set_msb(&(p_cpu->reg_AF), reg_a);
+	uint8_t reg_a = ~get_reg3(p_cpu, REG3_A);
+	set_reg3(p_cpu, REG3_A, reg_a);
 
 	set_flag_N(p_cpu, 1);
 	set_flag_H(p_cpu, 1);
 
-	DEBUG_PRINT("%04x:CPL\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -692,7 +1043,6 @@ static int opcode8_SCF(cpu_t *p_cpu)
 	set_flag_H(p_cpu, 0);
 	set_flag_C(p_cpu, 1);
 
-	DEBUG_PRINT("%04x:SCF\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -704,16 +1054,12 @@ static int opcode8_CCF(cpu_t *p_cpu)
 	set_flag_H(p_cpu, 0);
 	set_flag_C(p_cpu, !get_flag_C(p_cpu));
 
-	DEBUG_PRINT("%04x:CCF\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_LD_D_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_LD_D_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t opcode;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &opcode);
-
 	uint8_t d0 = (opcode >> 3) & 0x07;
 	uint8_t d1 = (opcode >> 0) & 0x07;
 
@@ -721,39 +1067,31 @@ static int opcode8_LD_D_D(cpu_t *p_cpu)
 
 	set_reg3(p_cpu, d0, dv);
 
-	DEBUG_PRINT("%04x:LD %s %s [%02x]\n", p_cpu->pc, str_reg3(d0), str_reg3(d1), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_LD_D_HL(cpu_t *p_cpu)
+CPU_INLINE int opcode8_LD_D_HL(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d >>= 3;
-	d &= 0x07;
+	uint8_t d = (opcode >> 3) & 0x07;
 
 	uint8_t value;
 	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->reg_HL, &value);
 
 	set_reg3(p_cpu, d, value);
 
-	DEBUG_PRINT("%04x:LD %s (HL) [%02x]\n", p_cpu->pc, str_reg3(d), value);
 	p_cpu->pc += 1;
 	return 8;
 }
 
-static int opcode8_LD_HL_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_LD_HL_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	(void)mmu_write_u8(p_cpu->p_mmu, p_cpu->reg_HL, dv);
 
-	DEBUG_PRINT("%04x:LD (HL) %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -763,127 +1101,102 @@ static int opcode8_HALT(cpu_t *p_cpu)
 {
 	p_cpu->halted = 1;
 
-	DEBUG_PRINT("%04x:HALT\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_ADD_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_ADD_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_ADD(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:ADD A %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_ADC_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_ADC_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_ADC(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:ADC A %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_SUB_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_SUB_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_SUB(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:SUB A %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_SBC_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_SBC_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_SBC(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:SBC A %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_AND_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_AND_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_AND(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:AND A %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_XOR_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_XOR_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_XOR(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:XOR A %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_OR_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_OR_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_OR(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:OR A %s [%02x]\n", p_cpu->pc, str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
 
-static int opcode8_CP_A_D(cpu_t *p_cpu)
+CPU_INLINE int opcode8_CP_A_D(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t d;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &d);
-	d &= 0x07;
+	uint8_t d = opcode & 0x07;
 
 	uint8_t dv = get_reg3(p_cpu, d);
 
 	alu_CP(p_cpu, dv);
 
-	DEBUG_PRINT("%04x:CP [%02x] A [%02x] %s [%02x]\n", p_cpu->pc, get_lsb(p_cpu->reg_AF), get_msb(p_cpu->reg_AF), str_reg3(d), dv);
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -895,7 +1208,6 @@ static int opcode8_ADD_A_HL(cpu_t *p_cpu)
 
 	alu_ADD(p_cpu, value);
 
-	DEBUG_PRINT("%04x:ADD A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -907,7 +1219,6 @@ static int opcode8_ADC_A_HL(cpu_t *p_cpu)
 
 	alu_ADC(p_cpu, value);
 
-	DEBUG_PRINT("%04x:ADC A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -919,7 +1230,6 @@ static int opcode8_SUB_A_HL(cpu_t *p_cpu)
 
 	alu_SUB(p_cpu, value);
 
-	DEBUG_PRINT("%04x:SUB A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -931,7 +1241,6 @@ static int opcode8_SBC_A_HL(cpu_t *p_cpu)
 
 	alu_SBC(p_cpu, value);
 
-	DEBUG_PRINT("%04x:SBC A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -943,7 +1252,6 @@ static int opcode8_AND_A_HL(cpu_t *p_cpu)
 
 	alu_AND(p_cpu, value);
 
-	DEBUG_PRINT("%04x:AND A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -955,7 +1263,6 @@ static int opcode8_XOR_A_HL(cpu_t *p_cpu)
 
 	alu_XOR(p_cpu, value);
 
-	DEBUG_PRINT("%04x:XOR A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -967,7 +1274,6 @@ static int opcode8_OR_A_HL(cpu_t *p_cpu)
 
 	alu_OR(p_cpu, value);
 
-	DEBUG_PRINT("%04x:OR A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -979,148 +1285,120 @@ static int opcode8_CP_A_HL(cpu_t *p_cpu)
 
 	alu_CP(p_cpu, value);
 
-	DEBUG_PRINT("%04x:CP A (HL) [%02x]\n", p_cpu->pc, value);
 	p_cpu->pc += 1;
 	return 8;
 }
 
 static int opcode8_ADD_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_ADD(p_cpu, n);
 
-	DEBUG_PRINT("%04x:ADD A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_ADC_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_ADC(p_cpu, n);
 
-	DEBUG_PRINT("%04x:ADC A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_SUB_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_SUB(p_cpu, n);
 
-	DEBUG_PRINT("%04x:SUB A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_SBC_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_SBC(p_cpu, n);
 
-	DEBUG_PRINT("%04x:SBC A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_AND_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_AND(p_cpu, n);
 
-	DEBUG_PRINT("%04x:AND A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_XOR_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_XOR(p_cpu, n);
 
-	DEBUG_PRINT("%04x:XOR A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_OR_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_OR(p_cpu, n);
 
-	DEBUG_PRINT("%04x:OR A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
 static int opcode8_CP_A_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	alu_CP(p_cpu, n);
 
-	DEBUG_PRINT("%04x:CP A %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 8;
 }
 
-static int opcode8_POP_R(cpu_t *p_cpu)
+CPU_INLINE int opcode8_POP_R(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r >>= 4;
-	r &= 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
 	uint16_t value = pop_u16(p_cpu);
 
 	set_reg1(p_cpu, r, value);
 
-	DEBUG_PRINT("%04x:POP %s [%04x]\n", p_cpu->pc, str_reg1(r), value);
 	p_cpu->pc += 1;
 	return 12;
 }
 
-static int opcode8_PUSH_R(cpu_t *p_cpu)
+CPU_INLINE int opcode8_PUSH_R(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t r;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &r);
-	r >>= 4;
-	r &= 0x03;
+	uint8_t r = (opcode >> 4) & 0x03;
 
 	uint16_t value = get_reg1(p_cpu, r);
 
 	push_u16(p_cpu, value);
 
-	DEBUG_PRINT("%04x:PUSH %s [%04x]\n", p_cpu->pc, str_reg1(r), value);
 	p_cpu->pc += 1;
 	return 16;
 }
 
 //Push present address onto stack.
 //Jump to address $0000 + n.
-static int opcode8_RST_N(cpu_t *p_cpu)
+CPU_INLINE int opcode8_RST_N(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &n);
-	n &= 0x38;
+	uint8_t n = opcode & 0x38;
 
-	DEBUG_PRINT("%04x:RST %04x\n", p_cpu->pc, (uint16_t)n);
 
 	p_cpu->pc += 1;
 	push_pc(p_cpu);
@@ -1130,27 +1408,21 @@ static int opcode8_RST_N(cpu_t *p_cpu)
 
 static int opcode8_RET(cpu_t *p_cpu)
 {
-	DEBUG_PRINT("%04x:RET\n", p_cpu->pc);
 	pop_pc(p_cpu);
 	return 8;
 }
 
 static int opcode8_RET_I(cpu_t *p_cpu)
 {
-	DEBUG_PRINT("%04x:RET I\n", p_cpu->pc);
 	pop_pc(p_cpu);
 	p_cpu->irq_master_enable = 1;
 	return 8;
 }
 
-static int opcode8_RET_F(cpu_t *p_cpu)
+CPU_INLINE int opcode8_RET_F(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t m;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &m);
-	m >>= 3;
-	m &= 0x03;
+	uint8_t m = (opcode >> 3) & 0x03;
 
-	DEBUG_PRINT("%04x:RET %s [%01x]\n", p_cpu->pc, str_mnemonic(m), get_lsb(p_cpu->reg_AF));
 	if (get_mnemonic(p_cpu, m))
 	{
 		pop_pc(p_cpu);
@@ -1164,25 +1436,18 @@ static int opcode8_RET_F(cpu_t *p_cpu)
 
 static int opcode8_JP_N(cpu_t *p_cpu)
 {
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
-	DEBUG_PRINT("%04x:JP %04x\n", p_cpu->pc, n);
 	jump(p_cpu, n);
 	return 12;
 }
 
-static int opcode8_JP_F_N(cpu_t *p_cpu)
+CPU_INLINE int opcode8_JP_F_N(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t m;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &m);
-	m >>= 3;
-	m &= 0x03;
+	uint8_t m = (opcode >> 3) & 0x03;
 
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
-	DEBUG_PRINT("%04x:JP %s [%02x] %04x\n", p_cpu->pc, str_mnemonic(m), get_lsb(p_cpu->reg_AF), n);
 	if (get_mnemonic(p_cpu, m))
 	{
 		jump(p_cpu, n);
@@ -1197,10 +1462,8 @@ static int opcode8_JP_F_N(cpu_t *p_cpu)
 
 static int opcode8_CALL_N(cpu_t *p_cpu)
 {
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
-	DEBUG_PRINT("%04x:CALL %04x\n", p_cpu->pc, n);
 
 	p_cpu->pc += 3;
 	push_pc(p_cpu);
@@ -1209,17 +1472,12 @@ static int opcode8_CALL_N(cpu_t *p_cpu)
 	return 12;
 }
 
-static int opcode8_CALL_F_N(cpu_t *p_cpu)
+CPU_INLINE int opcode8_CALL_F_N(cpu_t *p_cpu, uint8_t opcode)
 {
-	uint8_t m;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc, &m);
-	m >>= 3;
-	m &= 0x03;
+	uint8_t m = (opcode >> 3) & 0x03;
 
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
-	DEBUG_PRINT("%04x:CALL %s [%01x] %04x\n", p_cpu->pc, str_mnemonic(m), get_lsb(p_cpu->reg_AF), n);
 
 	p_cpu->pc += 3;
 	if (get_mnemonic(p_cpu, m))
@@ -1233,8 +1491,7 @@ static int opcode8_CALL_F_N(cpu_t *p_cpu)
 
 static int opcode8_ADD_SP_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	set_flag_Z(p_cpu, 0);
 	set_flag_N(p_cpu, 0);
@@ -1243,15 +1500,13 @@ static int opcode8_ADD_SP_N(cpu_t *p_cpu)
 
 	p_cpu->sp = p_cpu->sp + (int8_t)n;
 
-	DEBUG_PRINT("%04x:ADD SP %02x\n", p_cpu->pc, n);
 	p_cpu->pc += 2;
 	return 16;
 }
 
 static int opcode8_LD_HL_SP_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	p_cpu->reg_HL = p_cpu->sp + (int8_t)n;
 
@@ -1260,98 +1515,87 @@ static int opcode8_LD_HL_SP_N(cpu_t *p_cpu)
 	set_flag_H(p_cpu, ((p_cpu->sp & 0x0F) + (n & 0x0F)) > 0x0F);
 	set_flag_C(p_cpu, ((p_cpu->sp & 0xFF) + n) > 0xFF);
 
-	DEBUG_PRINT("%04x:LD HL SP+%02x [%04x]\n", p_cpu->pc, n, p_cpu->reg_HL);
 	p_cpu->pc += 2;
 	return 12;
 }
 
 static int opcode8_LD_FF00_N_A(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
-	uint8_t a = get_msb(p_cpu->reg_AF);
+	uint8_t a = get_reg3(p_cpu, REG3_A);
 
 	(void)mmu_write_u8(p_cpu->p_mmu, (uint16_t)0xFF00 + n, a);
 
-	DEBUG_PRINT("%04x:LD (%04x) A\n", p_cpu->pc, 0xFF00 + n, a);
 	p_cpu->pc += 2;
 	return 12;
 }
 
 static int opcode8_LD_A_FF00_N(cpu_t *p_cpu)
 {
-	uint8_t n;
-	(void)mmu_read_u8(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint8_t n = (uint8_t)p_cpu->operand;
 
 	uint8_t a;
 	(void)mmu_read_u8(p_cpu->p_mmu, (uint16_t)0xFF00 + n, &a);
+	p_cpu->poll_clock = p_cpu->p_mmu->clock;
 
-	set_msb(&(p_cpu->reg_AF), a);
+	set_reg3(p_cpu, REG3_A, a);
 
-	DEBUG_PRINT("%04x:LD A (%04x) [%02x]\n", p_cpu->pc, 0xFF00 + n, a);
 	p_cpu->pc += 2;
 	return 12;
 }
 
 static int opcode8_LD_C_A(cpu_t *p_cpu)
 {
-	uint16_t addr = (uint16_t)0xFF00 + get_lsb(p_cpu->reg_BC);
+	uint16_t addr = (uint16_t)0xFF00 + get_reg3(p_cpu, REG3_C);
 
-	uint8_t a = get_msb(p_cpu->reg_AF);
+	uint8_t a = get_reg3(p_cpu, REG3_A);
 
 	(void)mmu_write_u8(p_cpu->p_mmu, addr, a);
 
-	DEBUG_PRINT("%04x:LD (%04x) A [%02x]\n", p_cpu->pc, addr, a);
 	p_cpu->pc += 1;
 	return 8;
 }
 
 static int opcode8_LD_A_C(cpu_t *p_cpu)
 {
-	uint16_t addr = (uint16_t)0xFF00 + get_lsb(p_cpu->reg_BC);
+	uint16_t addr = (uint16_t)0xFF00 + get_reg3(p_cpu, REG3_C);
 
 	uint8_t a;
 	(void)mmu_read_u8(p_cpu->p_mmu, addr, &a);
 
-	set_msb(&(p_cpu->reg_AF), a);
+	set_reg3(p_cpu, REG3_A, a);
 
-	DEBUG_PRINT("%04x:LD A (%04x) [%02x]\n", p_cpu->pc, addr, a);
 	p_cpu->pc += 1;
 	return 8;
 }
 
 static int opcode8_LD_N_A(cpu_t *p_cpu)
 {
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
-	uint8_t a = get_msb(p_cpu->reg_AF);
+	uint8_t a = get_reg3(p_cpu, REG3_A);
 	(void)mmu_write_u8(p_cpu->p_mmu, n, a);
 
-	DEBUG_PRINT("%04x:LD (%04x) A [%02x]\n", p_cpu->pc, n, a);
 	p_cpu->pc += 3;
 	return 8;
 }
 
 static int opcode8_LD_A_N(cpu_t *p_cpu)
 {
-	uint16_t n;
-	(void)mmu_read_u16(p_cpu->p_mmu, p_cpu->pc + 1, &n);
+	uint16_t n = p_cpu->operand;
 
 	uint8_t a;
 	(void)mmu_read_u8(p_cpu->p_mmu, n, &a);
 
-	set_msb(&(p_cpu->reg_AF), a);
+	set_reg3(p_cpu, REG3_A, a);
 
-	DEBUG_PRINT("%04x:LD A (%04x) [%02x]\n", p_cpu->pc, n, a);
 	p_cpu->pc += 3;
 	return 8;
 }
 
 static int opcode8_JP_HL(cpu_t *p_cpu)
 {
-	DEBUG_PRINT("%04x:JP HL\n", p_cpu->pc);
 	jump(p_cpu, p_cpu->reg_HL);
 	return 4;
 }
@@ -1360,7 +1604,6 @@ static int opcode8_LD_SP_HL(cpu_t *p_cpu)
 {
 	p_cpu->sp = p_cpu->reg_HL;
 
-	DEBUG_PRINT("%04x:LD SP HL\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 8;
 }
@@ -1372,7 +1615,6 @@ static int opcode8_DI(cpu_t *p_cpu)
 {
 	p_cpu->di_counter = 2;
 
-	DEBUG_PRINT("%04x:DI\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -1384,7 +1626,6 @@ static int opcode8_EI(cpu_t *p_cpu)
 {
 	p_cpu->ei_counter = 2;
 
-	DEBUG_PRINT("%04x:EI\n", p_cpu->pc);
 	p_cpu->pc += 1;
 	return 4;
 }
@@ -2,9 +2,17 @@
 #define CPU_OPCODE8_H_
 
 #include "cpu_def.h"
-
-void opcode8_init(void);
+#include "cpu_opcode.h"
 
 int opcode8_handler(cpu_t *p_cpu);
 
+void opcode8_run(cpu_t *p_cpu);
+
+/* Specialized handler and length of an opcode, for the JIT. */
+opcode_handler_t opcode8_handler_get(uint8_t opcode);
+int opcode8_length(uint8_t opcode);
+
+/* 0 for the 11 opcodes without instruction, which lock the CPU up. */
+int opcode8_legal(uint8_t opcode);
+
 #endif /*CPU_OPCODE8_H_*/
@@ -45,8 +45,63 @@ typedef enum mnemonic_e
 
 /* Inlined function definitions */
 
+#ifdef CPU_LAZY_FLAGS
+/* Compute F from the last ALU operation, done before anything reads or
+changes a single flag. */
+static inline void flags_materialize(cpu_t *p_cpu)
+{
+    if (p_cpu->flags_op == CPU_FLAGS_NONE)
+    {
+        return;
+    }
+
+    uint8_t a = p_cpu->flags_a;
+    uint8_t b = p_cpu->flags_b;
+    uint8_t c = p_cpu->flags_carry;
+    uint16_t result = p_cpu->flags_result;
+    uint8_t f = (0 == (result & 0x00FF)) ? 0x80 : 0x00;
+
+    switch (p_cpu->flags_op)
+    {
+    case CPU_FLAGS_ADD:
+    case CPU_FLAGS_ADC:
+        f |= ((((a & 0x0F) + (b & 0x0F) + c) > 0x0F) ? 0x20 : 0x00) | ((result > 0xFF) ? 0x10 : 0x00);
+        break;
+    case CPU_FLAGS_SUB:
+    case CPU_FLAGS_SBC:
+        f |= 0x40 | (((a & 0x0F) < ((b & 0x0F) + c)) ? 0x20 : 0x00) | ((result > 0xFF) ? 0x10 : 0x00);
+        break;
+    case CPU_FLAGS_AND:
+        f |= 0x20;
+        break;
+    default:
+        break;
+    }
+
+    p_cpu->reg_AF = (p_cpu->reg_AF & 0xFF00) | f;
+    p_cpu->flags_op = CPU_FLAGS_NONE;
+}
+
+/* Record an ALU operation instead of computing its flags. */
+static inline void flags_record(cpu_t *p_cpu, cpu_flags_op_t op, uint8_t a, uint8_t b, uint8_t c, uint16_t result)
+{
+    p_cpu->flags_op = op;
+    p_cpu->flags_a = a;
+    p_cpu->flags_b = b;
+    p_cpu->flags_carry = c;
+    p_cpu->flags_result = result;
+}
+#else
+static inline void flags_materialize(cpu_t *p_cpu)
+{
+    (void)p_cpu;
+}
+#endif
+
 static inline void set_flag_Z(cpu_t *p_cpu, int flag)
 {
+    flags_materialize(p_cpu);
+
     if (flag)
     {
         p_cpu->reg_AF |= (uint16_t)0x0080;
@@ -59,11 +114,15 @@ static inline void set_flag_Z(cpu_t *p_cpu, int flag)
 
 static inline int get_flag_Z(cpu_t *p_cpu)
 {
+    flags_materialize(p_cpu);
+
     return (0 != (p_cpu->reg_AF & (uint16_t)0x0080));
 }
 
 static inline void set_flag_N(cpu_t *p_cpu, int flag)
 {
+    flags_materialize(p_cpu);
+
     if (flag)
     {
         p_cpu->reg_AF |= (uint16_t)0x0040;
@@ -76,11 +135,15 @@ static inline void set_flag_N(cpu_t *p_cpu, int flag)
 
 static inline uint8_t get_flag_N(cpu_t *p_cpu)
 {
+    flags_materialize(p_cpu);
+
     return (0 != (p_cpu->reg_AF & (uint16_t)0x0040));
 }
 
 static inline void set_flag_H(cpu_t *p_cpu, int flag)
 {
+    flags_materialize(p_cpu);
+
     if (flag)
     {
         p_cpu->reg_AF |= (uint16_t)0x0020;
@@ -93,11 +156,15 @@ static inline void set_flag_H(cpu_t *p_cpu, int flag)
 
 static inline int get_flag_H(cpu_t *p_cpu)
 {
+    flags_materialize(p_cpu);
+
     return (0 != (p_cpu->reg_AF & (uint16_t)0x0020));
 }
 
 static inline void set_flag_C(cpu_t *p_cpu, int flag)
 {
+    flags_materialize(p_cpu);
+
     if (flag)
     {
         p_cpu->reg_AF |= (uint16_t)0x0010;
@@ -110,6 +177,8 @@ static inline void set_flag_C(cpu_t *p_cpu, int flag)
 
 static inline int get_flag_C(cpu_t *p_cpu)
 {
+    flags_materialize(p_cpu);
+
     return (0 != (p_cpu->reg_AF & (uint16_t)0x0010));
 }
 
@@ -203,59 +272,16 @@ static inline const char *str_reg3(reg3_t d)
     }
 }
 
-static inline void set_reg3(cpu_t *p_cpu, reg3_t d, uint8_t value)
+CPU_INLINE void set_reg3(cpu_t *p_cpu, reg3_t d, uint8_t value)
 {
-    switch (d)
-    {
-    case REG3_B:
-        set_msb(&(p_cpu->reg_BC), value);
-        break;
-    case REG3_C:
-        set_lsb(&(p_cpu->reg_BC), value);
-        break;
-    case REG3_D:
-        set_msb(&(p_cpu->reg_DE), value);
-        break;
-    case REG3_E:
-        set_lsb(&(p_cpu->reg_DE), value);
-        break;
-    case REG3_H:
-        set_msb(&(p_cpu->reg_HL), value);
-        break;
-    case REG3_L:
-        set_lsb(&(p_cpu->reg_HL), value);
-        break;
-    case REG3_A:
-        set_msb(&(p_cpu->reg_AF), value);
-        break;
-    default:
-        assert(0);
-        break;
-    }
+    assert(d != 0b110);
+    p_cpu->r8[CPU_R8_INDEX(d)] = value;
 }
 
-static inline uint8_t get_reg3(cpu_t *p_cpu, reg3_t d)
+CPU_INLINE uint8_t get_reg3(cpu_t *p_cpu, reg3_t d)
 {
-    switch (d)
-    {
-    case REG3_B:
-        return get_msb(p_cpu->reg_BC);
-    case REG3_C:
-        return get_lsb(p_cpu->reg_BC);
-    case REG3_D:
-        return get_msb(p_cpu->reg_DE);
-    case REG3_E:
-        return get_lsb(p_cpu->reg_DE);
-    case REG3_H:
-        return get_msb(p_cpu->reg_HL);
-    case REG3_L:
-        return get_lsb(p_cpu->reg_HL);
-    case REG3_A:
-        return get_msb(p_cpu->reg_AF);
-    default:
-        assert(0);
-        return 0;
-    }
+    assert(d != 0b110);
+    return p_cpu->r8[CPU_R8_INDEX(d)];
 }
 
 static inline const char *str_reg2(reg2_t r)
@@ -276,44 +302,21 @@ static inline const char *str_reg2(reg2_t r)
     }
 }
 
-static inline void set_reg2(cpu_t *p_cpu, reg2_t r, uint16_t value)
+CPU_INLINE void set_reg2(cpu_t *p_cpu, reg2_t r, uint16_t value)
 {
-    switch (r)
+    if (r == REG2_SP)
     {
-    case REG2_BC:
-        p_cpu->reg_BC = value;
-        break;
-    case REG2_DE:
-        p_cpu->reg_DE = value;
-        break;
-    case REG2_HL:
-        p_cpu->reg_HL = value;
-        break;
-    case REG2_SP:
         p_cpu->sp = value;
-        break;
-    default:
-        assert(0);
-        break;
+    }
+    else
+    {
+        p_cpu->r16[r] = value;
     }
 }
 
-static inline uint16_t get_reg2(cpu_t *p_cpu, reg2_t r)
+CPU_INLINE uint16_t get_reg2(cpu_t *p_cpu, reg2_t r)
 {
-    switch (r)
-    {
-    case REG2_BC:
-        return p_cpu->reg_BC;
-    case REG2_DE:
-        return p_cpu->reg_DE;
-    case REG2_HL:
-        return p_cpu->reg_HL;
-    case REG2_SP:
-        return p_cpu->sp;
-    default:
-        assert(0);
-        return 0;
-    }
+    return (r == REG2_SP) ? p_cpu->sp : p_cpu->r16[r];
 }
 
 static inline const char *str_reg1(reg3_t r)
@@ -334,44 +337,26 @@ static inline const char *str_reg1(reg3_t r)
     }
 }
 
-static inline void set_reg1(cpu_t *p_cpu, reg1_t r, uint16_t value)
+CPU_INLINE void set_reg1(cpu_t *p_cpu, reg1_t r, uint16_t value)
 {
-    switch (r)
+    if (r == REG1_AF)
     {
-    case REG1_BC:
-        p_cpu->reg_BC = value;
-        break;
-    case REG1_DE:
-        p_cpu->reg_DE = value;
-        break;
-    case REG1_HL:
-        p_cpu->reg_HL = value;
-        break;
-    case REG1_AF:
-        p_cpu->reg_AF = value & 0xFFF0;
-        break;
-    default:
-        assert(0);
-        break;
+        flags_materialize(p_cpu);
+        value &= 0xFFF0;
     }
+
+    p_cpu->r16[r] = value;
 }
 
-static inline uint16_t get_reg1(cpu_t *p_cpu, reg1_t r)
+CPU_INLINE uint16_t get_reg1(cpu_t *p_cpu, reg1_t r)
 {
-    switch (r)
+    if (r == REG1_AF)
     {
-    case REG1_BC:
-        return p_cpu->reg_BC;
-    case REG1_DE:
-        return p_cpu->reg_DE;
-    case REG1_HL:
-        return p_cpu->reg_HL;
-    case REG1_AF:
+        flags_materialize(p_cpu);
         return p_cpu->reg_AF & 0xFFF0;
-    default:
-        assert(0);
-        return 0;
     }
+
+    return p_cpu->r16[r];
 }
 
 static inline const char *str_mnemonic(reg3_t m)
@@ -392,7 +377,7 @@ static inline const char *str_mnemonic(reg3_t m)
     }
 }
 
-static inline uint8_t get_mnemonic(cpu_t *p_cpu, mnemonic_t m)
+CPU_INLINE uint8_t get_mnemonic(cpu_t *p_cpu, mnemonic_t m)
 {
     switch (m)
     {
@@ -0,0 +1,329 @@
+#include "cpu_sampler.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Defines */
+
+#define SAMPLER_BANK_SIZE (0x4000)
+#define SAMPLER_NAME_LENGTH (64)
+
+/* Sort key of bank:address, the bank only counts in 0x4000 - 0x7FFF. */
+#define SAMPLER_KEY(bank, address) ((((address) >= 0x4000) && ((address) < 0x8000)) ? (((uint32_t)(bank) << 16) | (address)) : (address))
+
+/* Symbols only cover addresses of their own area: ROM0, ROMX or RAM. */
+#define SAMPLER_AREA(address) (((address) < 0x4000) ? 0 : (((address) < 0x8000) ? 1 : 2))
+
+/* Typedefs */
+
+typedef struct sampler_symbol_s
+{
+	uint32_t key;
+	char name[SAMPLER_NAME_LENGTH];
+} sampler_symbol_t;
+
+/* Report line, a function or a single address without symbol. */
+typedef struct sampler_line_s
+{
+	uint32_t key;
+	int symbol; /* Index in symbols, -1 for none. */
+	uint64_t samples;
+} sampler_line_t;
+
+struct cpu_sampler_s
+{
+	int period;
+	uint64_t next;
+	uint64_t samples;
+
+	uint32_t addresses[0x10000];             /* pc outside 0x4000 - 0x7FFF, bank 0 there. */
+	uint32_t *banks[CPU_SAMPLER_BANKS];      /* pc in 0x4000 - 0x7FFF, allocated on first sample. */
+
+	sampler_symbol_t *symbols; /* Sorted by key. */
+	int symbol_count;
+};
+
+/* Private function declarations */
+
+static int sampler_compare_symbols(const void *p_a, const void *p_b);
+static int sampler_compare_lines(const void *p_a, const void *p_b);
+static int sampler_find_symbol(cpu_sampler_t *p_sampler, uint32_t key);
+static int sampler_add_line(sampler_line_t **pp_lines, int *p_count, int *p_capacity, uint32_t key, int symbol, uint64_t samples);
+
+/* Public function definitions */
+
+cpu_sampler_t *cpu_sampler_allocate(int period)
+{
+	if (period <= 0)
+		return NULL;
+
+	cpu_sampler_t *p_sampler = calloc(1, sizeof(cpu_sampler_t));
+	if (p_sampler)
+	{
+		p_sampler->period = period;
+	}
+
+	return p_sampler;
+}
+
+void cpu_sampler_reset(cpu_sampler_t *p_sampler)
+{
+	if (p_sampler)
+	{
+		p_sampler->samples = 0;
+		(void)memset(p_sampler->addresses, 0, sizeof(p_sampler->addresses));
+
+		for (int bank = 0; bank < CPU_SAMPLER_BANKS; bank++)
+		{
+			if (p_sampler->banks[bank])
+			{
+				(void)memset(p_sampler->banks[bank], 0, SAMPLER_BANK_SIZE * sizeof(uint32_t));
+			}
+		}
+	}
+}
+
+int cpu_sampler_load_symbols(cpu_sampler_t *p_sampler, const char *path)
+{
+	if (!p_sampler || !path)
+		return -1;
+
+	FILE *file = fopen(path, "r");
+	if (!file)
+	{
+		printf("Failed to open file: %s\n", path);
+		return -1;
+	}
+
+	int ret = 0;
+	int capacity = p_sampler->symbol_count;
+	char line[256];
+
+	while ((ret == 0) && fgets(line, sizeof(line), file))
+	{
+		unsigned int bank;
+		unsigned int address;
+		char name[SAMPLER_NAME_LENGTH];
+
+		/* Comments (';') and section headers ("[labels]") do not match. */
+		if ((3 != sscanf(line, " %x:%x %63s", &bank, &address, name)) || (address > 0xFFFF))
+			continue;
+
+		if (p_sampler->symbol_count == capacity)
+		{
+			capacity = capacity ? (capacity * 2) : 256;
+
+			sampler_symbol_t *symbols = realloc(p_sampler->symbols, capacity * sizeof(sampler_symbol_t));
+			if (!symbols)
+			{
+				ret = -1;
+				break;
+			}
+			p_sampler->symbols = symbols;
+		}
+
+		sampler_symbol_t *p_symbol = &p_sampler->symbols[p_sampler->symbol_count++];
+		p_symbol->key = SAMPLER_KEY(bank % CPU_SAMPLER_BANKS, address);
+		(void)memcpy(p_symbol->name, name, sizeof(name));
+	}
+
+	(void)fclose(file);
+
+	if (ret < 0)
+	{
+		printf("Failed to load symbols: %s\n", path);
+	}
+
+	qsort(p_sampler->symbols, p_sampler->symbol_count, sizeof(sampler_symbol_t), sampler_compare_symbols);
+
+	return ret;
+}
+
+uint64_t cpu_sampler_next(cpu_sampler_t *p_sampler, uint64_t clock)
+{
+	/* First batch, or the clock went back with a snapshot. */
+	if ((p_sampler->next <= clock) || (p_sampler->next > (clock + p_sampler->period)))
+	{
+		p_sampler->next = clock + p_sampler->period;
+	}
+
+	return p_sampler->next;
+}
+
+void cpu_sampler_record(cpu_sampler_t *p_sampler, uint64_t clock, int bank, uint16_t pc)
+{
+	/* Several points after a HALT or a skipped polling loop. */
+	uint32_t samples = 0;
+	while (p_sampler->next <= clock)
+	{
+		p_sampler->next += p_sampler->period;
+		samples++;
+	}
+
+	if (!samples)
+		return;
+
+	p_sampler->samples += samples;
+
+	if ((pc < 0x4000) || (pc >= 0x8000))
+	{
+		p_sampler->addresses[pc] += samples;
+		return;
+	}
+
+	uint32_t **pp_bank = &p_sampler->banks[bank % CPU_SAMPLER_BANKS];
+	if (!*pp_bank)
+	{
+		*pp_bank = calloc(SAMPLER_BANK_SIZE, sizeof(uint32_t));
+		if (!*pp_bank)
+			return;
+	}
+
+	(*pp_bank)[pc - 0x4000] += samples;
+}
+
+void cpu_sampler_report(cpu_sampler_t *p_sampler)
+{
+	if (!p_sampler || !p_sampler->samples)
+		return;
+
+	sampler_line_t *lines = NULL;
+	int count = 0;
+	int capacity = 0;
+
+	/* Addresses in key order, a function's samples are contiguous. */
+	for (uint32_t key = 0; key < 0x10000; key++)
+	{
+		uint32_t samples = 0;
+
+		if ((key < 0x4000) || (key >= 0x8000))
+		{
+			samples = p_sampler->addresses[key];
+		}
+		else if (p_sampler->banks[0])
+		{
+			samples = p_sampler->banks[0][key - 0x4000];
+		}
+
+		if (samples && (sampler_add_line(&lines, &count, &capacity, key, sampler_find_symbol(p_sampler, key), samples) < 0))
+			break;
+	}
+
+	for (int bank = 1; bank < CPU_SAMPLER_BANKS; bank++)
+	{
+		for (uint32_t offset = 0; p_sampler->banks[bank] && (offset < SAMPLER_BANK_SIZE); offset++)
+		{
+			uint32_t samples = p_sampler->banks[bank][offset];
+			uint32_t key = SAMPLER_KEY(bank, 0x4000 + offset);
+
+			if (samples && (sampler_add_line(&lines, &count, &capacity, key, sampler_find_symbol(p_sampler, key), samples) < 0))
+				break;
+		}
+	}
+
+	qsort(lines, count, sizeof(sampler_line_t), sampler_compare_lines);
+
+	printf("%llu samples, every %d cycles.\n", (unsigned long long)p_sampler->samples, p_sampler->period);
+	printf("     %%       cycles  function\n");
+
+	for (int i = 0; (i < count) && (i < CPU_SAMPLER_REPORTED); i++)
+	{
+		sampler_line_t *p_line = &lines[i];
+		uint32_t key = (p_line->symbol < 0) ? p_line->key : p_sampler->symbols[p_line->symbol].key;
+
+		printf("%6.2f %12llu  %02X:%04X %s\n", (100.0 * p_line->samples) / p_sampler->samples,
+			   (unsigned long long)(p_line->samples * p_sampler->period), (unsigned int)(key >> 16),
+			   (unsigned int)(key & 0xFFFF), (p_line->symbol < 0) ? "" : p_sampler->symbols[p_line->symbol].name);
+	}
+
+	free(lines);
+}
+
+void cpu_sampler_free(cpu_sampler_t *p_sampler)
+{
+	if (p_sampler)
+	{
+		for (int bank = 0; bank < CPU_SAMPLER_BANKS; bank++)
+		{
+			free(p_sampler->banks[bank]);
+		}
+
+		free(p_sampler->symbols);
+		free(p_sampler);
+	}
+}
+
+/* Private function definitions */
+
+static int sampler_compare_symbols(const void *p_a, const void *p_b)
+{
+	uint32_t a = ((const sampler_symbol_t *)p_a)->key;
+	uint32_t b = ((const sampler_symbol_t *)p_b)->key;
+
+	return (a > b) - (a < b);
+}
+
+/* Most samples first. */
+static int sampler_compare_lines(const void *p_a, const void *p_b)
+{
+	uint64_t a = ((const sampler_line_t *)p_a)->samples;
+	uint64_t b = ((const sampler_line_t *)p_b)->samples;
+
+	return (a < b) - (a > b);
+}
+
+/* Last symbol at or before key in the same bank and area, -1 if none. */
+static int sampler_find_symbol(cpu_sampler_t *p_sampler, uint32_t key)
+{
+	int low = 0;
+	int high = p_sampler->symbol_count;
+
+	while (low < high)
+	{
+		int middle = (low + high) / 2;
+
+		if (p_sampler->symbols[middle].key <= key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	if (!low)
+		return -1;
+
+	uint32_t symbol = p_sampler->symbols[low - 1].key;
+	if (((symbol >> 16) != (key >> 16)) || (SAMPLER_AREA(symbol & 0xFFFF) != SAMPLER_AREA(key & 0xFFFF)))
+		return -1;
+
+	return low - 1;
+}
+
+/* Merged with the previous line when both fall in the same function. */
+static int sampler_add_line(sampler_line_t **pp_lines, int *p_count, int *p_capacity, uint32_t key, int symbol, uint64_t samples)
+{
+	if ((symbol >= 0) && *p_count && ((*pp_lines)[*p_count - 1].symbol == symbol))
+	{
+		(*pp_lines)[*p_count - 1].samples += samples;
+		return 0;
+	}
+
+	if (*p_count == *p_capacity)
+	{
+		int capacity = *p_capacity ? (*p_capacity * 2) : 256;
+
+		sampler_line_t *lines = realloc(*pp_lines, capacity * sizeof(sampler_line_t));
+		if (!lines)
+			return -1;
+
+		*pp_lines = lines;
+		*p_capacity = capacity;
+	}
+
+	sampler_line_t *p_line = &(*pp_lines)[(*p_count)++];
+	p_line->key = key;
+	p_line->symbol = symbol;
+	p_line->samples = samples;
+
+	return 0;
+}
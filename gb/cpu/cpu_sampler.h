@@ -0,0 +1,35 @@
+#ifndef CPU_SAMPLER_H_
+#define CPU_SAMPLER_H_
+
+#include <stdint.h>
+
+/* Sampling PC profiler. Every period emulated cycles the (ROM bank, pc) of the
+next instruction is counted, a sample stands for period cycles. The report
+groups samples by the function holding them, from RGBDS / no$gmb symbol files
+("BB:AAAA Name" lines), and by address where no symbol is loaded. */
+
+#define CPU_SAMPLER_BANKS (512)
+#define CPU_SAMPLER_PERIOD (64)   /* Default period, in cycles. */
+#define CPU_SAMPLER_REPORTED (32) /* Lines in the report. */
+
+typedef struct cpu_sampler_s cpu_sampler_t;
+
+cpu_sampler_t *cpu_sampler_allocate(int period);
+
+void cpu_sampler_reset(cpu_sampler_t *p_sampler);
+
+/* Adds the symbols of a .sym file to those loaded. */
+int cpu_sampler_load_symbols(cpu_sampler_t *p_sampler, const char *path);
+
+/* MMU clock of the next sample point after clock. */
+uint64_t cpu_sampler_next(cpu_sampler_t *p_sampler, uint64_t clock);
+
+/* Count the sample points up to clock for bank:pc. */
+void cpu_sampler_record(cpu_sampler_t *p_sampler, uint64_t clock, int bank, uint16_t pc);
+
+/* Hottest functions, with their share of the sampled cycles, on stdout. */
+void cpu_sampler_report(cpu_sampler_t *p_sampler);
+
+void cpu_sampler_free(cpu_sampler_t *p_sampler);
+
+#endif /*CPU_SAMPLER_H_*/
@@ -0,0 +1,236 @@
+#include "cpu_stats.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Defines */
+
+#define STATS_CALIBRATION (1000)
+#define STATS_TOP_PAIRS (20)
+
+/* Constants */
+
+static const char *const stats_class_names[CPU_STATS_CLASSES] = {"LD 8", "LD 16", "PUSH / POP", "ALU 8", "ALU 16", "Rotate / shift", "BIT / RES / SET", "Jump / call", "Control"};
+
+/* Private function declarations */
+
+static cpu_stats_class_t stats_class(int opcode);
+static int stats_compare_opcodes(const void *p_a, const void *p_b);
+
+/* Public function definitions */
+
+cpu_stats_t *cpu_stats_allocate(void)
+{
+	cpu_stats_t *p_stats = calloc(1, sizeof(cpu_stats_t));
+
+	if (p_stats)
+	{
+		for (int opcode = 0; opcode < CPU_STATS_OPCODES; opcode++)
+		{
+			p_stats->classes[opcode] = (uint8_t)stats_class(opcode);
+		}
+
+		/* Back to back timestamps, the cheapest of a few batches. */
+		p_stats->overhead = UINT64_MAX;
+		for (int batch = 0; batch < 8; batch++)
+		{
+			uint64_t start = cpu_stats_now();
+			for (int i = 0; i < STATS_CALIBRATION; i++)
+			{
+				(void)cpu_stats_now();
+			}
+
+			uint64_t overhead = (cpu_stats_now() - start) / (STATS_CALIBRATION + 1);
+			if (overhead < p_stats->overhead)
+			{
+				p_stats->overhead = overhead;
+			}
+		}
+
+		cpu_stats_reset(p_stats);
+	}
+
+	return p_stats;
+}
+
+void cpu_stats_reset(cpu_stats_t *p_stats)
+{
+	if (p_stats)
+	{
+		(void)memset(p_stats->counts, 0, sizeof(p_stats->counts));
+		(void)memset(p_stats->pairs, 0, sizeof(p_stats->pairs));
+		p_stats->previous = CPU_STATS_PAIR_NONE;
+		(void)memset(p_stats->instructions, 0, sizeof(p_stats->instructions));
+		(void)memset(p_stats->nanoseconds, 0, sizeof(p_stats->nanoseconds));
+		(void)memset(p_stats->cycles, 0, sizeof(p_stats->cycles));
+		p_stats->current = CPU_STATS_NONE;
+	}
+}
+
+uint64_t cpu_stats_now(void)
+{
+	struct timespec now;
+	(void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
+}
+
+void cpu_stats_pause(cpu_stats_t *p_stats, uint64_t clock)
+{
+	if (p_stats && (p_stats->current != CPU_STATS_NONE))
+	{
+		uint64_t elapsed = cpu_stats_now() - p_stats->start;
+
+		p_stats->nanoseconds[p_stats->current] += (elapsed > p_stats->overhead) ? (elapsed - p_stats->overhead) : 0;
+		p_stats->cycles[p_stats->current] += clock - p_stats->start_clock;
+		p_stats->current = CPU_STATS_NONE;
+	}
+}
+
+void cpu_stats_report(cpu_stats_t *p_stats)
+{
+	if (!p_stats)
+		return;
+
+	uint64_t instructions = 0;
+	for (int class = 0; class < CPU_STATS_CLASSES; class++)
+	{
+		instructions += p_stats->instructions[class];
+	}
+
+	if (!instructions)
+		return;
+
+	printf("%llu instructions, timestamp cost %llu ns.\n", (unsigned long long)instructions, (unsigned long long)p_stats->overhead);
+	printf("class                  count      %%      cycles          ns  ns / cycle\n");
+
+	for (int class = 0; class < CPU_STATS_CLASSES; class++)
+	{
+		uint64_t cycles = p_stats->cycles[class];
+
+		printf("%-16s %12llu %6.2f %11llu %11llu  %10.3f\n", stats_class_names[class], (unsigned long long)p_stats->instructions[class],
+			   (100.0 * p_stats->instructions[class]) / instructions, (unsigned long long)cycles,
+			   (unsigned long long)p_stats->nanoseconds[class], cycles ? ((double)p_stats->nanoseconds[class] / cycles) : 0.0);
+	}
+
+	/* Count and opcode pairs, sorted on the count. */
+	uint64_t keys[CPU_STATS_OPCODES][2];
+	for (int opcode = 0; opcode < CPU_STATS_OPCODES; opcode++)
+	{
+		keys[opcode][0] = p_stats->counts[opcode];
+		keys[opcode][1] = (uint64_t)opcode;
+	}
+	qsort(keys, CPU_STATS_OPCODES, sizeof(keys[0]), stats_compare_opcodes);
+
+	printf("opcode         count      %%\n");
+	for (int i = 0; (i < CPU_STATS_OPCODES) && keys[i][0]; i++)
+	{
+		int opcode = (int)keys[i][1];
+
+		printf("%s%02X %16llu %6.2f\n", (opcode & 0x100) ? "CB " : "   ", opcode & 0xFF, (unsigned long long)keys[i][0],
+			   (100.0 * keys[i][0]) / instructions);
+	}
+
+	/* Most frequent pairs, kept sorted on the count while going through all of them. */
+	uint64_t top[STATS_TOP_PAIRS][2] = {{0}};
+	for (int pair = 0; pair < 0x10000; pair++)
+	{
+		uint64_t count = p_stats->pairs[pair >> 8][pair & 0xFF];
+		if (count <= top[STATS_TOP_PAIRS - 1][0])
+			continue;
+
+		int i = STATS_TOP_PAIRS - 1;
+		for (; (i > 0) && (count > top[i - 1][0]); i--)
+		{
+			top[i][0] = top[i - 1][0];
+			top[i][1] = top[i - 1][1];
+		}
+		top[i][0] = count;
+		top[i][1] = (uint64_t)pair;
+	}
+
+	printf("pair           count      %%\n");
+	for (int i = 0; (i < STATS_TOP_PAIRS) && top[i][0]; i++)
+	{
+		printf("%02X %02X %13llu %6.2f\n", (int)(top[i][1] >> 8), (int)(top[i][1] & 0xFF), (unsigned long long)top[i][0],
+			   (100.0 * top[i][0]) / instructions);
+	}
+}
+
+void cpu_stats_free(cpu_stats_t *p_stats)
+{
+	if (p_stats)
+	{
+		free(p_stats);
+	}
+}
+
+/* Private function definitions */
+
+static cpu_stats_class_t stats_class(int opcode)
+{
+	int x = (opcode >> 6) & 3;
+	int y = (opcode >> 3) & 7;
+	int z = opcode & 7;
+
+	if (opcode & 0x100)
+		return (x == 0) ? CPU_STATS_ROTATE : CPU_STATS_BIT;
+
+	if (x == 1)
+		return (opcode == 0x76) ? CPU_STATS_CONTROL : CPU_STATS_LD8;
+
+	if (x == 2)
+		return CPU_STATS_ALU8;
+
+	if (x == 0)
+	{
+		switch (z)
+		{
+		case 0:
+			return (y == 1) ? CPU_STATS_LD16 : ((y >= 3) ? CPU_STATS_JUMP : CPU_STATS_CONTROL);
+		case 1:
+			return (y & 1) ? CPU_STATS_ALU16 : CPU_STATS_LD16;
+		case 2:
+		case 6:
+			return CPU_STATS_LD8;
+		case 3:
+			return CPU_STATS_ALU16;
+		case 4:
+		case 5:
+			return CPU_STATS_ALU8;
+		default:
+			return (y < 4) ? CPU_STATS_ROTATE : CPU_STATS_ALU8;
+		}
+	}
+
+	switch (z)
+	{
+	case 0:
+		return (y < 4) ? CPU_STATS_JUMP : ((y == 5) ? CPU_STATS_ALU16 : ((y == 7) ? CPU_STATS_LD16 : CPU_STATS_LD8));
+	case 1:
+		return !(y & 1) ? CPU_STATS_STACK : ((y == 7) ? CPU_STATS_LD16 : CPU_STATS_JUMP);
+	case 2:
+		return (y < 4) ? CPU_STATS_JUMP : CPU_STATS_LD8;
+	case 3:
+		return ((y == 0) ? CPU_STATS_JUMP : CPU_STATS_CONTROL); /* JP, CB prefix, DI / EI, unused. */
+	case 4:
+		return (y < 4) ? CPU_STATS_JUMP : CPU_STATS_CONTROL;
+	case 5:
+		return !(y & 1) ? CPU_STATS_STACK : ((y == 1) ? CPU_STATS_JUMP : CPU_STATS_CONTROL);
+	case 6:
+		return CPU_STATS_ALU8;
+	default:
+		return CPU_STATS_JUMP; /* RST. */
+	}
+}
+
+/* Highest count first. */
+static int stats_compare_opcodes(const void *p_a, const void *p_b)
+{
+	uint64_t a = ((const uint64_t *)p_a)[0];
+	uint64_t b = ((const uint64_t *)p_b)[0];
+
+	return (a < b) - (a > b);
+}
@@ -0,0 +1,108 @@
+#ifndef CPU_STATS_H_
+#define CPU_STATS_H_
+
+#include <stdint.h>
+
+/* Opcode statistics, only compiled in with CPU_STATS defined.
+Each of the 512 opcodes is counted when its handler runs: 0x000 - 0x0FF for
+opcode8_handlers (0xCB included), 0x100 - 0x1FF for opcode16_handlers. Host
+time and emulated cycles are accounted per opcode class, from one timestamp
+per instruction: the interval up to the next one (dispatch included) goes to
+the class of the instruction, less the cost of taking the timestamp. The JIT
+is left out (see CPU_JIT_ENABLED), its blocks would not be accounted.
+Consecutive opcode8_handlers opcodes are counted as pairs, the candidates for
+the superinstructions of cpu_opcode8.c. */
+
+#define CPU_STATS_OPCODES (512)
+#define CPU_STATS_PAIR_NONE (0x100) /* No previous opcode. */
+
+typedef enum cpu_stats_class_e
+{
+    CPU_STATS_LD8 = 0,
+    CPU_STATS_LD16,
+    CPU_STATS_STACK,
+    CPU_STATS_ALU8,
+    CPU_STATS_ALU16,
+    CPU_STATS_ROTATE,
+    CPU_STATS_BIT,
+    CPU_STATS_JUMP,
+    CPU_STATS_CONTROL,
+    CPU_STATS_CLASSES,
+    CPU_STATS_NONE = CPU_STATS_CLASSES /* No instruction timed, between batches. */
+} cpu_stats_class_t;
+
+typedef struct cpu_stats_s
+{
+    uint64_t counts[CPU_STATS_OPCODES];
+    uint64_t pairs[0x100][0x100]; /* First opcode, then second. */
+    int previous;
+    uint64_t instructions[CPU_STATS_CLASSES];
+    uint64_t nanoseconds[CPU_STATS_CLASSES];
+    uint64_t cycles[CPU_STATS_CLASSES];
+
+    uint8_t classes[CPU_STATS_OPCODES];
+
+    /* Interval in progress. */
+    cpu_stats_class_t current;
+    uint64_t start;
+    uint64_t start_clock;
+    uint64_t overhead; /* Cost of a timestamp, nanoseconds. */
+} cpu_stats_t;
+
+cpu_stats_t *cpu_stats_allocate(void);
+
+void cpu_stats_reset(cpu_stats_t *p_stats);
+
+/* Host clock, nanoseconds. */
+uint64_t cpu_stats_now(void);
+
+/* Close the interval in progress at clock, nothing is timed until the next
+instruction. Called at the end of each batch. */
+void cpu_stats_pause(cpu_stats_t *p_stats, uint64_t clock);
+
+/* Per class accounting, then opcodes and the most frequent pairs by count, on stdout. */
+void cpu_stats_report(cpu_stats_t *p_stats);
+
+void cpu_stats_free(cpu_stats_t *p_stats);
+
+/* Called by the opcode handlers, clock is the MMU clock before the opcode.
+The 0xCB prefix is counted but only the opcode it leads to starts an interval. */
+static inline void cpu_stats_opcode(cpu_stats_t *p_stats, int opcode, uint64_t clock)
+{
+    p_stats->counts[opcode]++;
+
+    if (opcode < 0x100)
+    {
+        if (p_stats->previous != CPU_STATS_PAIR_NONE)
+        {
+            p_stats->pairs[p_stats->previous][opcode]++;
+        }
+        p_stats->previous = opcode;
+    }
+
+    if (opcode == 0xCB)
+        return;
+
+    uint64_t now = cpu_stats_now();
+
+    if (p_stats->current != CPU_STATS_NONE)
+    {
+        uint64_t elapsed = now - p_stats->start;
+
+        p_stats->nanoseconds[p_stats->current] += (elapsed > p_stats->overhead) ? (elapsed - p_stats->overhead) : 0;
+        p_stats->cycles[p_stats->current] += clock - p_stats->start_clock;
+    }
+
+    p_stats->current = p_stats->classes[opcode];
+    p_stats->instructions[p_stats->current]++;
+    p_stats->start = now;
+    p_stats->start_clock = clock;
+}
+
+#ifdef CPU_STATS
+#define CPU_STATS_OPCODE(p_cpu, opcode) cpu_stats_opcode((p_cpu)->stats, (opcode), (p_cpu)->p_mmu->clock)
+#else
+#define CPU_STATS_OPCODE(p_cpu, opcode)
+#endif
+
+#endif /*CPU_STATS_H_*/
@@ -0,0 +1,126 @@
+#include "cpu_trace.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private function declarations */
+
+static int trace_write(int fd, const void *data, size_t size);
+
+/* Public function definitions */
+
+cpu_trace_t *cpu_trace_allocate(void)
+{
+	return calloc(1, sizeof(cpu_trace_t));
+}
+
+void cpu_trace_reset(cpu_trace_t *p_trace)
+{
+	if (p_trace)
+	{
+		p_trace->count = 0;
+	}
+}
+
+int cpu_trace_dump(cpu_trace_t *p_trace, const char *path)
+{
+	if (!p_trace || !path)
+		return -1;
+
+	FILE *file = fopen(path, "wb");
+	if (!file)
+	{
+		printf("Failed to open file: %s\n", path);
+		return -1;
+	}
+
+	int ret = cpu_trace_write(p_trace, fileno(file));
+
+	if (0 != fclose(file))
+	{
+		ret = -1;
+	}
+
+	if (ret < 0)
+	{
+		printf("Failed to write CPU trace: %s\n", path);
+	}
+
+	return ret;
+}
+
+int cpu_trace_write(cpu_trace_t *p_trace, int fd)
+{
+	if (!p_trace || (fd < 0))
+		return -1;
+
+	uint64_t count = p_trace->count;
+	uint64_t first = 0;
+
+	if (count > CPU_TRACE_LENGTH)
+	{
+		first = count - CPU_TRACE_LENGTH;
+	}
+
+	uint8_t header[12] = {'G', 'B', 'T', 'R'};
+	uint32_t fields[2] = {CPU_TRACE_VERSION, (uint32_t)(count - first)};
+	(void)memcpy(&header[4], fields, sizeof(fields));
+
+	if (trace_write(fd, header, sizeof(header)) < 0)
+		return -1;
+
+	/* Oldest first, the ring may wrap once. */
+	for (uint64_t index = first; index < count;)
+	{
+		size_t slot = (size_t)(index & (CPU_TRACE_LENGTH - 1));
+		size_t length = (size_t)(count - index);
+
+		if (length > (CPU_TRACE_LENGTH - slot))
+		{
+			length = CPU_TRACE_LENGTH - slot;
+		}
+
+		if (trace_write(fd, &p_trace->entries[slot], length * sizeof(cpu_trace_entry_t)) < 0)
+			return -1;
+
+		index += length;
+	}
+
+	return 0;
+}
+
+void cpu_trace_free(cpu_trace_t *p_trace)
+{
+	if (p_trace)
+	{
+		free(p_trace);
+	}
+}
+
+/* Private function definitions */
+
+/* All of data, write may return early. */
+static int trace_write(int fd, const void *data, size_t size)
+{
+	const uint8_t *p_data = data;
+
+	while (size)
+	{
+		ssize_t written = write(fd, p_data, size);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return -1;
+		}
+
+		p_data += written;
+		size -= (size_t)written;
+	}
+
+	return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef CPU_TRACE_H_
+#define CPU_TRACE_H_
+
+#include <stdint.h>
+
+/* Instruction trace, a ring buffer keeping the last CPU_TRACE_LENGTH
+instructions. Enabled at runtime with cpu_set_trace: batches then go through a
+recording loop, a disabled trace costs one test per batch.
+
+Dumps are binary, decoded offline by tools/gbtrace.c:
+-> char magic[4] "GBTR".
+-> uint32_t version, count.
+-> cpu_trace_entry_t entries[count], oldest first.
+Host byte order. */
+
+#define CPU_TRACE_VERSION (1)
+#define CPU_TRACE_LENGTH (0x10000) /* Power of two. */
+
+#define CPU_TRACE_IME (0x01)
+
+/* Registers and MMU clock before the instruction, 32 bytes. */
+typedef struct cpu_trace_entry_s
+{
+    uint64_t clock;
+    uint16_t pc;
+    uint16_t sp;
+    uint16_t af;
+    uint16_t bc;
+    uint16_t de;
+    uint16_t hl;
+    uint16_t bank;    /* ROM bank, pc in 0x4000 - 0x7FFF only. */
+    uint8_t bytes[3]; /* Instruction bytes, read in place. */
+    uint8_t size;     /* Bytes read, 0 when pc is in a page not read in place. */
+    uint8_t flags;    /* CPU_TRACE_IME. */
+    uint8_t reserved[5];
+} cpu_trace_entry_t;
+
+typedef struct cpu_trace_s
+{
+    uint64_t count; /* Instructions recorded since the last reset. */
+    cpu_trace_entry_t entries[CPU_TRACE_LENGTH];
+} cpu_trace_t;
+
+cpu_trace_t *cpu_trace_allocate(void);
+
+void cpu_trace_reset(cpu_trace_t *p_trace);
+
+int cpu_trace_dump(cpu_trace_t *p_trace, const char *path);
+
+/* Same dump to an open file, from its current offset. Only uses write(2),
+so it may be called from a signal handler. */
+int cpu_trace_write(cpu_trace_t *p_trace, int fd);
+
+void cpu_trace_free(cpu_trace_t *p_trace);
+
+static inline cpu_trace_entry_t *cpu_trace_next(cpu_trace_t *p_trace)
+{
+    return &p_trace->entries[p_trace->count++ & (CPU_TRACE_LENGTH - 1)];
+}
+
+#endif /*CPU_TRACE_H_*/
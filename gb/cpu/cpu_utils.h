@@ -3,6 +3,14 @@
 
 #include <stdint.h>
 
+/* Forced inlining, for helpers taking operands that are constant in the
+specialized opcode handlers. */
+#if defined(__GNUC__)
+#define CPU_INLINE static inline __attribute__((always_inline))
+#else
+#define CPU_INLINE static inline
+#endif
+
 static inline void set_msb(uint16_t *p_word, uint8_t value)
 {
 	*p_word &= (uint16_t)0x00FF;
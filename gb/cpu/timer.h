@@ -2,6 +2,8 @@
 #define TIMER_H_
 
 #include "cpu_def.h"
+#include "mmu.h"
+#include <limits.h>
 
 /* Timer
 0xFF04 DIV  Divider Register.
@@ -21,75 +23,132 @@
 #define TIMER_REG_TMA (0xFF06)
 #define TIMER_REG_TAC (0xFF07)
 
-static inline void timer_run(cpu_t *p_cpu)
+#define TIMER_REG_IF (0xFF0F)
+
+/* Register write hooks. */
+
+static inline int timer_io_write_div(void *p_context, uint16_t address, uint8_t data)
 {
-    p_cpu->div_counter += 1;
+    cpu_t *p_cpu = p_context;
 
-    if (p_cpu->div_counter >= 256)
-    {
-        p_cpu->div_counter = 0;
+    (void)data;
 
-        uint8_t div;
-        (void)mmu_read_u8(p_cpu->p_mmu, TIMER_REG_DIV, &div);
+    /* Any write resets the divider. */
+    p_cpu->div_counter = 0;
 
-        div += 1;
+    mmu_io_set(p_cpu->p_mmu, address, 0);
+    return 0;
+}
+
+static inline int timer_io_write_tac(void *p_context, uint16_t address, uint8_t data)
+{
+    cpu_t *p_cpu = p_context;
 
-        (void)mmu_write_u8(p_cpu->p_mmu, TIMER_REG_DIV, div);
+    p_cpu->tim_enabled = (0 != ((data >> 2) & 0x01));
+
+    switch (data & 0x03)
+    {
+    case 0:
+        p_cpu->tim_clock = 1024;
+        break;
+    case 1:
+        p_cpu->tim_clock = 16;
+        break;
+    case 2:
+        p_cpu->tim_clock = 64;
+        break;
+    case 3:
+        p_cpu->tim_clock = 256;
+        break;
     }
 
-    uint8_t tac;
-    (void)mmu_read_u8(p_cpu->p_mmu, TIMER_REG_TAC, &tac);
+    mmu_io_set(p_cpu->p_mmu, address, data | 0xF8);
+    return 0;
+}
 
-    if ((tac >> 2) & 0x01)
+static inline void timer_register(cpu_t *p_cpu)
+{
+    (void)mmu_register_io(p_cpu->p_mmu, TIMER_REG_DIV, NULL, timer_io_write_div, p_cpu);
+    (void)mmu_register_io(p_cpu->p_mmu, TIMER_REG_TAC, NULL, timer_io_write_tac, p_cpu);
+}
+
+static inline void timer_tima_tick(cpu_t *p_cpu)
+{
+    uint8_t tima = mmu_io_get(p_cpu->p_mmu, TIMER_REG_TIMA);
+
+    if (0xFF == tima)
     {
-        //timer enabled.
+        tima = mmu_io_get(p_cpu->p_mmu, TIMER_REG_TMA);
 
-        switch (tac & 0x03)
-        {
-        case 0:
-            p_cpu->tim_clock = 1024;
-            break;
-        case 1:
-            p_cpu->tim_clock = 16;
-            break;
-        case 2:
-            p_cpu->tim_clock = 64;
-            break;
-        case 3:
-            p_cpu->tim_clock = 256;
-            break;
-        }
+        mmu_io_set(p_cpu->p_mmu, TIMER_REG_TIMA, tima);
 
-        p_cpu->tim_counter += 1;
+        uint8_t irq_flags = mmu_io_get(p_cpu->p_mmu, TIMER_REG_IF);
 
-        if (p_cpu->tim_counter >= p_cpu->tim_clock)
-        {
-            p_cpu->tim_counter = 0;
+        irq_flags |= (1 << 2);
 
-            uint8_t tima;
-            (void)mmu_read_u8(p_cpu->p_mmu, TIMER_REG_TIMA, &tima);
+        mmu_io_set(p_cpu->p_mmu, TIMER_REG_IF, irq_flags);
+    }
+    else
+    {
+        tima += 1;
 
-            if (0xFF == tima)
-            {
-                uint8_t tma;
-                (void)mmu_read_u8(p_cpu->p_mmu, TIMER_REG_TMA, &tma);
+        mmu_io_set(p_cpu->p_mmu, TIMER_REG_TIMA, tima);
+    }
+}
+
+/* Cycles the timer can run before TIMA overflows and raises its IRQ.
+DIV and TIMA increments have no side effect, reads catch up through the MMU sync. */
+static inline int timer_quiet_cycles(cpu_t *p_cpu)
+{
+    if (!p_cpu->tim_enabled)
+        return INT_MAX;
 
-                tima = tma;
+    /* Same first tick as timer_advance, then one tick per clock up to 0xFF. */
+    int first = p_cpu->tim_clock - p_cpu->tim_counter;
+    if (first < 1)
+    {
+        first = 1;
+    }
 
-                (void)mmu_write_u8(p_cpu->p_mmu, TIMER_REG_TIMA, tima);
+    uint8_t tima = mmu_io_get(p_cpu->p_mmu, TIMER_REG_TIMA);
 
-                uint8_t irq_flags;
-                (void)mmu_read_u8(p_cpu->p_mmu, 0xFF0F, &irq_flags);
+    return first - 1 + ((0xFF - tima) * p_cpu->tim_clock);
+}
 
-                irq_flags |= (1 << 2);
+/* Advance DIV and TIMA by cycles clock cycles at once. */
+static inline void timer_advance(cpu_t *p_cpu, int cycles)
+{
+    if (cycles <= 0)
+        return;
 
-                (void)mmu_write_u8(p_cpu->p_mmu, 0xFF0F, irq_flags);
-            }
-            else
-            {
-                tima += 1;
+    int div_counter = p_cpu->div_counter + cycles;
+    if (div_counter >= 256)
+    {
+        mmu_io_set(p_cpu->p_mmu, TIMER_REG_DIV, mmu_io_get(p_cpu->p_mmu, TIMER_REG_DIV) + (div_counter / 256));
+    }
+    p_cpu->div_counter = div_counter % 256;
+
+    if (p_cpu->tim_enabled)
+    {
+        /* The counter may be past a lowered clock, it then ticks on the next cycle. */
+        int first = p_cpu->tim_clock - p_cpu->tim_counter;
+        if (first < 1)
+        {
+            first = 1;
+        }
 
-                (void)mmu_write_u8(p_cpu->p_mmu, TIMER_REG_TIMA, tima);
+        if (cycles < first)
+        {
+            p_cpu->tim_counter += cycles;
+        }
+        else
+        {
+            cycles -= first;
+            p_cpu->tim_counter = cycles % p_cpu->tim_clock;
+
+            for (int ticks = 1 + (cycles / p_cpu->tim_clock); ticks > 0; ticks--)
+            {
+                timer_tima_tick(p_cpu);
             }
         }
     }
@@ -4,35 +4,158 @@
 #include "cpu/cpu.h"
 #include "ppu/ppu.h"
 #include "screen.h"
+#include "apu/apu.h"
+#include "joypad/joypad.h"
+#include "serial/serial.h"
 #include "timer.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef min
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 #endif
 
-void gb_init(void)
+/* The timer ticks before and the PPU after the CPU instruction of a cycle,
+bring both in line with an instruction starting at the current clock. */
+static void gb_catch_up(gb_t *p_gb)
 {
-    cpu_init();
+    uint64_t clock = p_gb->mmu->clock;
+
+    timer_advance(p_gb->cpu, (int)(clock + 1 - p_gb->timer_clock));
+    p_gb->timer_clock = clock + 1;
+
+    ppu_run(p_gb->ppu, (int)(clock - p_gb->ppu_clock));
+    p_gb->ppu_clock = clock;
 }
 
+/* CPU registers, clock, RAM and cartridge state, the rest follows from them. */
+static int gb_compare(gb_t *p_gb, gb_t *p_reference)
+{
+    cpu_t *p_cpu = p_gb->cpu;
+    cpu_t *p_ref = p_reference->cpu;
+
+    cpu_sync_flags(p_cpu);
+    cpu_sync_flags(p_ref);
+
+    if ((p_cpu->reg_AF != p_ref->reg_AF) || (p_cpu->reg_BC != p_ref->reg_BC) || (p_cpu->reg_DE != p_ref->reg_DE) ||
+        (p_cpu->reg_HL != p_ref->reg_HL) || (p_cpu->sp != p_ref->sp) || (p_cpu->pc != p_ref->pc) ||
+        (p_cpu->irq_master_enable != p_ref->irq_master_enable) || (p_cpu->halted != p_ref->halted))
+    {
+        printf("JIT diverged at clock %llu: pc %04X / %04X, AF %04X / %04X, BC %04X / %04X, DE %04X / %04X, HL %04X / %04X, SP %04X / %04X.\n",
+               (unsigned long long)p_gb->mmu->clock, p_cpu->pc, p_ref->pc, p_cpu->reg_AF, p_ref->reg_AF, p_cpu->reg_BC,
+               p_ref->reg_BC, p_cpu->reg_DE, p_ref->reg_DE, p_cpu->reg_HL, p_ref->reg_HL, p_cpu->sp, p_ref->sp);
+        return -1;
+    }
+
+    /* RAM is 0x8000 - 0xFFFF. */
+    for (int address = 0x8000; address <= 0xFFFF; address++)
+    {
+        uint8_t data = p_gb->mmu->ram[address - 0x8000];
+        uint8_t expected = p_reference->mmu->ram[address - 0x8000];
+
+        if (data != expected)
+        {
+            printf("JIT diverged at clock %llu: %04X = %02X / %02X.\n", (unsigned long long)p_gb->mmu->clock, address,
+                   data, expected);
+            return -1;
+        }
+    }
+
+    cartridge_t *p_cartridge = p_gb->mmu->cartridge;
+    cartridge_t *p_ref_cartridge = p_reference->mmu->cartridge;
+    if (!p_cartridge || !p_ref_cartridge)
+    {
+        return 0;
+    }
+
+    if ((p_cartridge->rom_bank != p_ref_cartridge->rom_bank) || (p_cartridge->ram_bank != p_ref_cartridge->ram_bank) ||
+        (p_cartridge->ram_enabled != p_ref_cartridge->ram_enabled) ||
+        (p_cartridge->ram_banking_mode != p_ref_cartridge->ram_banking_mode) ||
+        (p_cartridge->rtc_select != p_ref_cartridge->rtc_select))
+    {
+        printf("JIT diverged at clock %llu: ROM bank %X / %X, RAM bank %X / %X, RAM enabled %d / %d, banking mode %d / %d, RTC register %02X / %02X.\n",
+               (unsigned long long)p_gb->mmu->clock, p_cartridge->rom_bank, p_ref_cartridge->rom_bank, p_cartridge->ram_bank,
+               p_ref_cartridge->ram_bank, p_cartridge->ram_enabled, p_ref_cartridge->ram_enabled,
+               p_cartridge->ram_banking_mode, p_ref_cartridge->ram_banking_mode, p_cartridge->rtc_select,
+               p_ref_cartridge->rtc_select);
+        return -1;
+    }
+
+    for (size_t offset = 0; offset < p_cartridge->ram_length; offset++)
+    {
+        if (p_cartridge->ram[offset] != p_ref_cartridge->ram[offset])
+        {
+            printf("JIT diverged at clock %llu: cartridge RAM %05zX = %02X / %02X.\n", (unsigned long long)p_gb->mmu->clock,
+                   offset, p_cartridge->ram[offset], p_ref_cartridge->ram[offset]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Called by the MMU on IO accesses, a write may change the timer or PPU
+deadline so the CPU leaves its batch after the instruction. */
+static void gb_sync(void *p_context, int write)
+{
+    gb_t *p_gb = p_context;
+
+    gb_catch_up(p_gb);
+
+    if (write)
+    {
+        cpu_stop(p_gb->cpu);
+    }
+}
+
+/* Arena layout, each structure aligned on a cache line:
+Front, state in allocation order:
+-> gb_t.
+-> mmu_t, page table first, then cartridge_t (bank registers, RTC).
+-> cpu_t, ppu_t, screen_t, joypad_t, serial_t, apu_t.
+Back, bulk buffers from the end of the arena:
+-> Boot ROM, RAM 0x8000 - 0xFFFF, DMA and watchpoint page tables, instruction cache, screen buffer.
+ROM images are shared read only and cartridge RAM is allocated with the
+cartridge (or mapped from its save file), both live outside the arena. */
 gb_t *gb_allocate(void)
 {
-    gb_t *p_gb = calloc(1, sizeof(gb_t));
+    size_t size = ARENA_SIZE(sizeof(gb_t)) + mmu_arena_size() + cpu_arena_size() + ppu_arena_size() + screen_arena_size() +
+                  joypad_arena_size() + serial_arena_size() + apu_arena_size();
 
-    if (p_gb)
+    arena_t *p_arena = arena_allocate(size);
+    if (!p_arena)
+    {
+        return NULL;
+    }
+
+    gb_t *p_gb = arena_alloc(p_arena, sizeof(gb_t));
+
+    if (!p_gb)
+    {
+        arena_free(p_arena);
+    }
+    else
     {
-        p_gb->mmu = mmu_allocate();
-        p_gb->cpu = cpu_allocate(p_gb->mmu);
-        p_gb->screen = screen_allocate();
-        p_gb->ppu = ppu_allocate(p_gb->mmu, p_gb->screen);
+        p_gb->arena = p_arena;
+        p_gb->mmu = mmu_allocate(p_arena);
+        p_gb->cpu = cpu_allocate(p_arena, p_gb->mmu);
+        p_gb->screen = screen_allocate(p_arena);
+        p_gb->ppu = ppu_allocate(p_arena, p_gb->mmu, p_gb->screen);
+        p_gb->joypad = joypad_allocate(p_arena, p_gb->mmu);
+        p_gb->serial = serial_allocate(p_arena, p_gb->mmu);
+        p_gb->apu = apu_allocate(p_arena, p_gb->mmu);
 
-        if (!p_gb->mmu || !p_gb->cpu || !p_gb->ppu || !p_gb->screen)
+        if (!p_gb->mmu || !p_gb->cpu || !p_gb->ppu || !p_gb->screen || !p_gb->joypad || !p_gb->serial || !p_gb->apu)
         {
             gb_free(p_gb);
             p_gb = NULL;
         }
+        else
+        {
+            mmu_set_sync(p_gb->mmu, gb_sync, p_gb);
+        }
     }
 
     return p_gb;
@@ -50,6 +173,13 @@ int gb_load_program(gb_t *p_gb, char *boot, char *rom)
         return -1;
     }
 
+    cpu_flush_cache(p_gb->cpu);
+
+    if (p_gb->reference && (gb_load_program(p_gb->reference, boot, rom) < 0))
+    {
+        return -1;
+    }
+
     return 0;
 }
 
@@ -71,66 +201,263 @@ int gb_execute(gb_t *p_gb, double duration_ms)
     }
 
     int cycles = (int)(duration_ms * ((4.0 * 1024.0 * 1024.0) / 1000.0));
-    int cpu_cycles = 0;
-    int ppu_cycles = 0;
-    int mmu_cycles = 0;
 
     /**********/
     cycles *= 2;
     /**********/
 
-    while (cycles > 0)
+    mmu_t *p_mmu = p_gb->mmu;
+    uint64_t end = p_mmu->clock + cycles;
+
+    /* The CPU runs ahead in batches, up to the next cycle at which the timer
+    or the PPU can do something visible (interrupt, mode change). Both
+    catch up at the start of each batch and on IO accesses. A halted CPU
+    skips to the end of its batch, and as it cannot write VRAM / OAM the PPU
+    may run through pixel transfer unsynchronized. */
+    while (p_mmu->clock < end)
     {
-        timer_run(p_gb->cpu);
+        gb_catch_up(p_gb);
 
-        if (!cpu_cycles)
-        {
-            cpu_cycles = cpu_execute(p_gb->cpu);
-        }
+        int ppu_quiet = p_gb->cpu->halted ? ppu_irq_quiet_cycles(p_gb->ppu) : ppu_quiet_cycles(p_gb->ppu);
+        int quiet = min(ppu_quiet, timer_quiet_cycles(p_gb->cpu));
+        uint64_t until = min(end, p_mmu->clock + 1 + quiet);
 
-        if (!ppu_cycles)
-        {
-            ppu_cycles = ppu_execute(p_gb->ppu);
-        }
+        cpu_run(p_gb->cpu, until);
+    }
+
+    /* Cycles of the last instruction past the end are dropped. */
+    p_mmu->clock = end;
+
+    timer_advance(p_gb->cpu, (int)(end - p_gb->timer_clock));
+    p_gb->timer_clock = end;
 
-        if (!mmu_cycles)
+    ppu_run(p_gb->ppu, (int)(end - p_gb->ppu_clock));
+    p_gb->ppu_clock = end;
+
+    if (p_gb->reference)
+    {
+        if (gb_execute(p_gb->reference, duration_ms) < 0)
         {
-            mmu_cycles = mmu_execute(p_gb->mmu);
+            return -1;
         }
 
-        int wait_cycles = min(cpu_cycles, ppu_cycles);
+        return gb_compare(p_gb, p_gb->reference);
+    }
+
+    return 0;
+}
+
+int gb_set_jit(gb_t *p_gb, gb_jit_mode_t mode)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    if (cpu_set_jit(p_gb->cpu, mode != GB_JIT_OFF) < 0)
+    {
+        printf("JIT not supported by this build.\n");
+        return -1;
+    }
 
-        if (!wait_cycles)
+    if ((mode == GB_JIT_DIFF) && !p_gb->reference)
+    {
+        p_gb->reference = gb_allocate();
+        if (!p_gb->reference)
         {
-            //TODO error
+            return -1;
         }
 
-        cycles -= wait_cycles;
-        cpu_cycles -= wait_cycles;
-        ppu_cycles -= wait_cycles;
+        /* Both instances would write the save file, the reference works on a copy. */
+        mmu_set_save(p_gb->reference->mmu, 0);
+    }
+    else if ((mode != GB_JIT_DIFF) && p_gb->reference)
+    {
+        gb_free(p_gb->reference);
+        p_gb->reference = NULL;
     }
 
     return 0;
 }
 
+void gb_set_rumble_callback(gb_t *p_gb, gb_rumble_callback_t callback, void *p_context)
+{
+    if (!p_gb)
+    {
+        return;
+    }
+
+    mmu_set_rumble(p_gb->mmu, callback, p_context);
+}
+
 void gb_free(gb_t *p_gb)
 {
     if (p_gb)
     {
-        ppu_free(p_gb->ppu);
-        p_gb->ppu = NULL;
+        gb_free(p_gb->reference);
+        p_gb->reference = NULL;
 
         cpu_free(p_gb->cpu);
-        p_gb->mmu = NULL;
 
         mmu_free(p_gb->mmu);
         p_gb->mmu = NULL;
 
-        screen_free(p_gb->screen);
-        p_gb->screen = NULL;
+        /* Everything else lives in the arena, p_gb included. */
+        arena_free(p_gb->arena);
+    }
+}
+
+/* Snapshots start with the identity of the instance and cartridge they were
+taken from, arena pointers are only valid for the same arena. */
+typedef struct gb_snapshot_header_s
+{
+    const uint8_t *base;
+    size_t rom_length;
+    size_t ram_length;
+    uint16_t global_checksum;
+    uint8_t header_checksum;
+} gb_snapshot_header_t;
+
+static void gb_snapshot_header(gb_t *p_gb, gb_snapshot_header_t *p_header)
+{
+    cartridge_t *p_cartridge = p_gb->mmu->cartridge;
+
+    (void)memset(p_header, 0, sizeof(gb_snapshot_header_t));
+    p_header->base = p_gb->arena->base;
+
+    if (p_cartridge)
+    {
+        p_header->rom_length = p_cartridge->rom_length;
+        p_header->ram_length = p_cartridge->ram_length;
+        p_header->global_checksum = p_cartridge->header.global_checksum;
+        p_header->header_checksum = p_cartridge->header.header_checksum;
+    }
+}
+
+/* The reference snapshot follows the one of its instance. */
+static int gb_snapshot_check(gb_t *p_gb, const uint8_t *buffer)
+{
+    gb_snapshot_header_t expected;
+    gb_snapshot_header_t header;
+
+    gb_snapshot_header(p_gb, &expected);
+    (void)memcpy(&header, buffer, sizeof(gb_snapshot_header_t));
+
+    if ((header.base != expected.base) || (header.rom_length != expected.rom_length) ||
+        (header.ram_length != expected.ram_length) || (header.global_checksum != expected.global_checksum) ||
+        (header.header_checksum != expected.header_checksum))
+    {
+        printf("Snapshot of another instance or cartridge.\n");
+        return -1;
+    }
+
+    if (p_gb->reference)
+    {
+        return gb_snapshot_check(p_gb->reference, buffer + sizeof(gb_snapshot_header_t) + p_gb->arena->size + header.ram_length);
+    }
+
+    return 0;
+}
+
+size_t gb_snapshot_size(gb_t *p_gb)
+{
+    if (!p_gb)
+    {
+        return 0;
+    }
+
+    cartridge_t *p_cartridge = p_gb->mmu->cartridge;
+
+    return sizeof(gb_snapshot_header_t) + p_gb->arena->size + (p_cartridge ? p_cartridge->ram_length : 0) +
+           gb_snapshot_size(p_gb->reference);
+}
+
+int gb_snapshot_save(gb_t *p_gb, void *buffer, size_t size)
+{
+    if (!p_gb || !buffer || (size != gb_snapshot_size(p_gb)))
+    {
+        return -1;
+    }
+
+    cartridge_t *p_cartridge = p_gb->mmu->cartridge;
+    uint8_t *p_data = buffer;
+
+    gb_snapshot_header_t header;
+    gb_snapshot_header(p_gb, &header);
+    (void)memcpy(p_data, &header, sizeof(gb_snapshot_header_t));
+    p_data += sizeof(gb_snapshot_header_t);
+
+    (void)memcpy(p_data, p_gb->arena->base, p_gb->arena->size);
+    p_data += p_gb->arena->size;
+
+    if (p_cartridge && p_cartridge->ram_length)
+    {
+        (void)memcpy(p_data, p_cartridge->ram, p_cartridge->ram_length);
+        p_data += p_cartridge->ram_length;
+    }
 
-        free(p_gb);
+    if (p_gb->reference)
+    {
+        return gb_snapshot_save(p_gb->reference, p_data, gb_snapshot_size(p_gb->reference));
     }
+
+    return 0;
+}
+
+static void gb_snapshot_load(gb_t *p_gb, const uint8_t *buffer)
+{
+    /* p_gb is part of the arena, keep what lives outside before it is overwritten. */
+    arena_t *p_arena = p_gb->arena;
+    gb_t *p_reference = p_gb->reference;
+    cpu_jit_t *p_jit = p_gb->cpu->jit;
+    cpu_trace_t *p_trace = p_gb->cpu->trace;
+    cpu_sampler_t *p_sampler = p_gb->cpu->sampler;
+#ifdef CPU_STATS
+    cpu_stats_t *p_stats = p_gb->cpu->stats;
+#endif
+    mmu_host_t host;
+    mmu_host_save(p_gb->mmu, &host);
+
+    buffer += sizeof(gb_snapshot_header_t);
+    (void)memcpy(p_arena->base, buffer, p_arena->size);
+    buffer += p_arena->size;
+
+    p_gb->arena = p_arena;
+    p_gb->reference = p_reference;
+    p_gb->cpu->jit = p_jit;
+    p_gb->cpu->trace = p_trace;
+    p_gb->cpu->sampler = p_sampler;
+#ifdef CPU_STATS
+    p_gb->cpu->stats = p_stats;
+#endif
+    mmu_host_restore(p_gb->mmu, &host);
+
+    cartridge_t *p_cartridge = p_gb->mmu->cartridge;
+    if (p_cartridge && p_cartridge->ram_length)
+    {
+        (void)memcpy(p_cartridge->ram, buffer, p_cartridge->ram_length);
+        buffer += p_cartridge->ram_length;
+        cartridge_ram_changed(p_cartridge);
+    }
+
+    cpu_flush_cache(p_gb->cpu);
+
+    if (p_gb->reference)
+    {
+        gb_snapshot_load(p_gb->reference, buffer);
+    }
+}
+
+int gb_snapshot_restore(gb_t *p_gb, const void *buffer, size_t size)
+{
+    if (!p_gb || !buffer || (size != gb_snapshot_size(p_gb)) || (gb_snapshot_check(p_gb, buffer) < 0))
+    {
+        return -1;
+    }
+
+    gb_snapshot_load(p_gb, buffer);
+
+    return 0;
 }
 
 /* DEBUG */
@@ -142,3 +469,113 @@ void gb_dbg_read_mem(gb_t *p_gb, int address, int size, char *buffer)
         (void)mmu_read_u8(p_gb->mmu, address + i, buffer + i);
     }
 }
+
+int gb_dbg_watch_add(gb_t *p_gb, int address, int kinds)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return mmu_watch_add(p_gb->mmu, (uint16_t)address, kinds);
+}
+
+int gb_dbg_watch_remove(gb_t *p_gb, int address, int kinds)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return mmu_watch_remove(p_gb->mmu, (uint16_t)address, kinds);
+}
+
+void gb_dbg_set_watch_callback(gb_t *p_gb, mmu_watch_callback_t callback, void *p_context)
+{
+    if (!p_gb)
+    {
+        return;
+    }
+
+    mmu_set_watch_callback(p_gb->mmu, callback, p_context);
+}
+
+int gb_dbg_dump_profile(gb_t *p_gb, const char *path)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return mmu_dump_profile(p_gb->mmu, path);
+}
+
+int gb_dbg_set_trace(gb_t *p_gb, int enabled)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return cpu_set_trace(p_gb->cpu, enabled);
+}
+
+int gb_dbg_dump_trace(gb_t *p_gb, const char *path)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return cpu_dump_trace(p_gb->cpu, path);
+}
+
+int gb_dbg_write_trace(gb_t *p_gb, int fd)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return cpu_write_trace(p_gb->cpu, fd);
+}
+
+int gb_dbg_set_sampler(gb_t *p_gb, int period)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return cpu_set_sampler(p_gb->cpu, period);
+}
+
+int gb_dbg_load_symbols(gb_t *p_gb, const char *path)
+{
+    if (!p_gb)
+    {
+        return -1;
+    }
+
+    return cpu_load_symbols(p_gb->cpu, path);
+}
+
+void gb_dbg_report_samples(gb_t *p_gb)
+{
+    if (!p_gb)
+    {
+        return;
+    }
+
+    cpu_report_samples(p_gb->cpu);
+}
+
+void gb_dbg_report_stats(gb_t *p_gb)
+{
+    if (!p_gb)
+    {
+        return;
+    }
+
+    cpu_report_stats(p_gb->cpu);
+}
@@ -6,18 +6,39 @@
 #include "cpu.h"
 #include "ppu.h"
 #include "cpu_def.h"
+#include "apu.h"
+#include "joypad.h"
+#include "serial.h"
+#include "arena.h"
 
 //typedef struct gb_s gb_t;
 
+/* GB_JIT_DIFF runs an interpreter only instance next to the JIT one and
+compares both after each gb_execute. The reference never writes the save file. */
+typedef enum
+{
+    GB_JIT_OFF,
+    GB_JIT_ON,
+    GB_JIT_DIFF
+} gb_jit_mode_t;
+
+/* All machine state lives in a single arena, see gb_allocate for its layout. */
 typedef struct gb_s
 {
+    arena_t *arena;
     mmu_t *mmu;
     cpu_t *cpu;
     ppu_t *ppu;
     screen_t *screen;
-} gb_t;
+    joypad_t *joypad;
+    serial_t *serial;
+    apu_t *apu;
 
-void gb_init(void);
+    uint64_t timer_clock; /* MMU clock up to which the timer has run. */
+    uint64_t ppu_clock;   /* MMU clock up to which the PPU has run. */
+
+    struct gb_s *reference; /* Interpreter only instance, GB_JIT_DIFF. */
+} gb_t;
 
 gb_t *gb_allocate(void);
 
@@ -27,10 +48,52 @@ screen_t *gb_get_screen(gb_t *p_gb);
 
 int gb_execute(gb_t *p_gb, double duration_ms);
 
+/* Called with 1 / 0 when a rumble cartridge starts / stops its motor. */
+typedef void (*gb_rumble_callback_t)(void *p_context, int enabled);
+
+void gb_set_rumble_callback(gb_t *p_gb, gb_rumble_callback_t callback, void *p_context);
+
+/* Fails unless built with CPU_JIT on x86-64 Linux. GB_JIT_DIFF is set before
+gb_load_program, gb_execute then returns -1 on the first divergence. */
+int gb_set_jit(gb_t *p_gb, gb_jit_mode_t mode);
+
 void gb_free(gb_t *p_gb);
 
+/* Snapshots are the arena followed by the cartridge RAM, and the snapshot of the
+GB_JIT_DIFF reference if any. They are only valid for the instance and cartridge
+they were taken from, restoring others fails. */
+size_t gb_snapshot_size(gb_t *p_gb);
+int gb_snapshot_save(gb_t *p_gb, void *buffer, size_t size);
+int gb_snapshot_restore(gb_t *p_gb, const void *buffer, size_t size);
+
 /***********************/
 
 void gb_dbg_read_mem(gb_t *p_gb, int address, int size, char *buffer);
 
+/* kinds is a combination of MMU_WATCH_READ, MMU_WATCH_WRITE and MMU_WATCH_EXECUTE. */
+int gb_dbg_watch_add(gb_t *p_gb, int address, int kinds);
+int gb_dbg_watch_remove(gb_t *p_gb, int address, int kinds);
+void gb_dbg_set_watch_callback(gb_t *p_gb, mmu_watch_callback_t callback, void *p_context);
+
+/* Memory access heat map, CSV when path ends with ".csv". Needs MMU_PROFILE. */
+int gb_dbg_dump_profile(gb_t *p_gb, const char *path);
+
+/* Ring buffer of the last instructions run, decoded by tools/gbtrace. Tracing
+runs the interpreter one instruction at a time, the JIT is bypassed.
+gb_dbg_write_trace writes the same dump to an open file with write(2) only,
+for signal handlers. */
+int gb_dbg_set_trace(gb_t *p_gb, int enabled);
+int gb_dbg_dump_trace(gb_t *p_gb, const char *path);
+int gb_dbg_write_trace(gb_t *p_gb, int fd);
+
+/* Sampling profiler, pc counted every period emulated cycles (0 disables).
+Symbols are RGBDS / no$gmb .sym files, loaded once sampling. The report of the
+hottest functions goes to stdout. */
+int gb_dbg_set_sampler(gb_t *p_gb, int period);
+int gb_dbg_load_symbols(gb_t *p_gb, const char *path);
+void gb_dbg_report_samples(gb_t *p_gb);
+
+/* Opcode counts and host time per opcode class on stdout. Needs CPU_STATS. */
+void gb_dbg_report_stats(gb_t *p_gb);
+
 #endif /*GB_H_*/
\ No newline at end of file
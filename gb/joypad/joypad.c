@@ -0,0 +1,91 @@
+#include "joypad.h"
+
+#include <stdlib.h>
+
+#define JOYPAD_REG_P1 (0xFF00)
+#define JOYPAD_REG_IF (0xFF0F)
+
+struct joypad_s
+{
+    mmu_t *mmu;
+    uint8_t select; /* P14 - P15, active low. */
+    uint8_t keys;
+};
+
+static int joypad_read_p1(void *p_context, uint16_t address, uint8_t *data);
+static int joypad_write_p1(void *p_context, uint16_t address, uint8_t data);
+
+size_t joypad_arena_size(void)
+{
+    return ARENA_SIZE(sizeof(joypad_t));
+}
+
+joypad_t *joypad_allocate(arena_t *p_arena, mmu_t *p_mmu)
+{
+    if (!p_mmu)
+        return NULL;
+
+    joypad_t *p_joypad = arena_alloc(p_arena, sizeof(joypad_t));
+
+    if (p_joypad)
+    {
+        p_joypad->mmu = p_mmu;
+        p_joypad->select = 0x30;
+
+        (void)mmu_register_io(p_mmu, JOYPAD_REG_P1, joypad_read_p1, joypad_write_p1, p_joypad);
+    }
+
+    return p_joypad;
+}
+
+void joypad_set_keys(joypad_t *p_joypad, uint8_t keys)
+{
+    if (!p_joypad)
+        return;
+
+    uint8_t pressed = keys & ~p_joypad->keys;
+    p_joypad->keys = keys;
+
+    if (pressed)
+    {
+        /* Joypad IRQ on any new key press. */
+        mmu_io_set(p_joypad->mmu, JOYPAD_REG_IF, mmu_io_get(p_joypad->mmu, JOYPAD_REG_IF) | 0x10);
+    }
+}
+
+/* Private function definitions */
+
+static int joypad_read_p1(void *p_context, uint16_t address, uint8_t *data)
+{
+    joypad_t *p_joypad = p_context;
+
+    (void)address;
+
+    uint8_t keys = 0;
+
+    if (!(p_joypad->select & 0x10))
+    {
+        /* Direction keys. */
+        keys |= p_joypad->keys & 0x0F;
+    }
+
+    if (!(p_joypad->select & 0x20))
+    {
+        /* Button keys. */
+        keys |= (p_joypad->keys >> 4) & 0x0F;
+    }
+
+    *data = 0xC0 | p_joypad->select | (~keys & 0x0F);
+    return 0;
+}
+
+static int joypad_write_p1(void *p_context, uint16_t address, uint8_t data)
+{
+    joypad_t *p_joypad = p_context;
+
+    /* Only key selection is writable. */
+    p_joypad->select = data & 0x30;
+
+    mmu_io_set(p_joypad->mmu, address, data);
+    return 0;
+}
@@ -1,6 +1,13 @@
 #ifndef JOYPAD_H_
 #define JOYPAD_H_
 
+#include "../mmu/mmu.h"
+#include "../arena.h"
+
+#include <stdint.h>
+
+typedef struct joypad_s joypad_t;
+
 /* Joypad Input
 0xFF00 P1 Joypad.
 -> P10 Right / A
@@ -11,4 +18,23 @@
 -> P15 Button keys.
 */
 
+/* Pressed keys mask. */
+enum joypad_key_e
+{
+    JOYPAD_KEY_RIGHT = (1 << 0),
+    JOYPAD_KEY_LEFT = (1 << 1),
+    JOYPAD_KEY_UP = (1 << 2),
+    JOYPAD_KEY_DOWN = (1 << 3),
+    JOYPAD_KEY_A = (1 << 4),
+    JOYPAD_KEY_B = (1 << 5),
+    JOYPAD_KEY_SELECT = (1 << 6),
+    JOYPAD_KEY_START = (1 << 7)
+};
+
+size_t joypad_arena_size(void);
+
+joypad_t *joypad_allocate(arena_t *p_arena, mmu_t *p_mmu);
+
+void joypad_set_keys(joypad_t *p_joypad, uint8_t keys);
+
 #endif /*JOYPAD_H_*/
\ No newline at end of file
@@ -1,11 +1,23 @@
 #include "cartridge.h"
+#include "rom_cache.h"
+#include "save_file.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
-static uint8_t *load_file(char *path, cartridge_header_t *p_header);
-static void parse_header(uint8_t *rom, cartridge_header_t *p_header);
+#define ROM_BANK_SIZE (0x4000)
+#define RAM_BANK_SIZE (0x2000)
+
+static void parse_header(const uint8_t *rom, cartridge_header_t *p_header);
+static void cartridge_update_banks(cartridge_t *p_cartridge);
+
+static size_t ram_size(uint8_t ram_size_code);
+static size_t ram_save_size(uint8_t ram_size_code);
+static char *make_save_path(const char *rom_path);
+static void cartridge_open_save(cartridge_t *p_cartridge, const char *rom_path);
+static void cartridge_copy_save(cartridge_t *p_cartridge, const char *rom_path);
+static void cartridge_save_rtc(cartridge_t *p_cartridge);
 
 static int cartridge_read_rom_simple(cartridge_t *p_cartridge, uint16_t address, uint8_t *data);
 static int cartridge_write_rom_simple(cartridge_t *p_cartridge, uint16_t address, uint8_t data);
@@ -17,59 +29,147 @@ static int cartridge_write_rom_mbc1(cartridge_t *p_cartridge, uint16_t address,
 static int cartridge_read_ram_mbc1(cartridge_t *p_cartridge, uint16_t address, uint8_t *data);
 static int cartridge_write_ram_mbc1(cartridge_t *p_cartridge, uint16_t address, uint8_t data);
 
-cartridge_t *cartridge_allocate(char *path)
+static int cartridge_read_rom_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t *data);
+static int cartridge_write_rom_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t data);
+static int cartridge_read_ram_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t *data);
+static int cartridge_write_ram_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t data);
+
+static int cartridge_write_rom_mbc5(cartridge_t *p_cartridge, uint16_t address, uint8_t data);
+
+int cartridge_load(cartridge_t *p_cartridge, char *path, const uint64_t *p_clock, int save)
 {
-    cartridge_t *p_cartridge = malloc(sizeof(cartridge_t));
+    if (!p_cartridge)
+        return -1;
 
-    if (p_cartridge)
+    (void)memset(p_cartridge, 0, sizeof(cartridge_t));
+
+    p_cartridge->rom = rom_cache_acquire(path, &p_cartridge->rom_length);
+    if (!p_cartridge->rom)
     {
-        p_cartridge->rom = load_file(path, &p_cartridge->header);
+        return -1;
+    }
 
-        p_cartridge->ram = malloc(0x2000); //TODO
+    parse_header(p_cartridge->rom, &p_cartridge->header);
 
-        p_cartridge->rom_bank = 1;
-        p_cartridge->ram_bank = 0,
-        p_cartridge->ram_banking_mode = 0;
-        p_cartridge->ram_enabled = 0;
+    p_cartridge->ram_length = ram_size(p_cartridge->header.ram_size);
+    p_cartridge->ram_save_length = ram_save_size(p_cartridge->header.ram_size);
 
-        switch (p_cartridge->header.type)
-        {
-        case CART_TYPE_ROM:
-            p_cartridge->read_rom = cartridge_read_rom_simple;
-            p_cartridge->write_rom = cartridge_write_rom_simple;
-            p_cartridge->read_ram = cartridge_read_ram_simple;
-            p_cartridge->write_ram = cartridge_write_ram_simple;
-            break;
-
-        case CART_TYPE_MBC1:
-        case CART_TYPE_MBC1_RAM:
-        case CART_TYPE_MBC1_RAM_BATTERY:
-            p_cartridge->read_rom = cartridge_read_rom_mbc1;
-            p_cartridge->write_rom = cartridge_write_rom_mbc1;
-            p_cartridge->read_ram = cartridge_read_ram_mbc1;
-            p_cartridge->write_ram = cartridge_write_ram_mbc1;
-            break;
-
-        default:
-            printf("Unsuported cartridge type %d", p_cartridge->header.type);
-            exit(-1);
-            break;
-        }
+    p_cartridge->rom_bank = 1;
+    p_cartridge->ram_bank = 0,
+    p_cartridge->ram_banking_mode = 0;
+    p_cartridge->ram_enabled = 0;
 
-        if (!p_cartridge->rom || !p_cartridge->rom)
-        {
-            cartridge_free(p_cartridge);
-            p_cartridge = NULL;
-        }
+    switch (p_cartridge->header.type)
+    {
+    case CART_TYPE_ROM:
+        p_cartridge->ram_enabled = 1;
+        p_cartridge->read_rom = cartridge_read_rom_simple;
+        p_cartridge->write_rom = cartridge_write_rom_simple;
+        p_cartridge->read_ram = cartridge_read_ram_simple;
+        p_cartridge->write_ram = cartridge_write_ram_simple;
+        break;
+
+    case CART_TYPE_MBC1_RAM_BATTERY:
+        p_cartridge->battery = 1;
+        /* Fall through. */
+    case CART_TYPE_MBC1:
+    case CART_TYPE_MBC1_RAM:
+        p_cartridge->read_rom = cartridge_read_rom_mbc1;
+        p_cartridge->write_rom = cartridge_write_rom_mbc1;
+        p_cartridge->read_ram = cartridge_read_ram_mbc1;
+        p_cartridge->write_ram = cartridge_write_ram_mbc1;
+        break;
+
+    case CART_TYPE_MBC3_TIMER_BATTERY:
+    case CART_TYPE_MBC3_TIMER_RAM_BATTERY:
+        p_cartridge->has_rtc = 1;
+        /* Fall through. */
+    case CART_TYPE_MBC3_RAM_BATTERY:
+        p_cartridge->battery = 1;
+        /* Fall through. */
+    case CART_TYPE_MBC3:
+    case CART_TYPE_MBC3_RAM:
+        p_cartridge->read_rom = cartridge_read_rom_mbc3;
+        p_cartridge->write_rom = cartridge_write_rom_mbc3;
+        p_cartridge->read_ram = cartridge_read_ram_mbc3;
+        p_cartridge->write_ram = cartridge_write_ram_mbc3;
+        break;
+
+    case CART_TYPE_MBC5_RUMBLE_RAM_BATTERY:
+        p_cartridge->battery = 1;
+        /* Fall through. */
+    case CART_TYPE_MBC5_RUMBLE:
+    case CART_TYPE_MBC5_RUMBLE_RAM:
+        p_cartridge->has_rumble = 1;
+        p_cartridge->read_rom = cartridge_read_rom_mbc1;
+        p_cartridge->write_rom = cartridge_write_rom_mbc5;
+        p_cartridge->read_ram = cartridge_read_ram_mbc1;
+        p_cartridge->write_ram = cartridge_write_ram_mbc1;
+        break;
+
+    case CART_TYPE_MBC5_RAM_BATTERY:
+        p_cartridge->battery = 1;
+        /* Fall through. */
+    case CART_TYPE_MBC5:
+    case CART_TYPE_MBC5_RAM:
+        p_cartridge->read_rom = cartridge_read_rom_mbc1;
+        p_cartridge->write_rom = cartridge_write_rom_mbc5;
+        p_cartridge->read_ram = cartridge_read_ram_mbc1;
+        p_cartridge->write_ram = cartridge_write_ram_mbc1;
+        break;
+
+    default:
+        printf("Unsuported cartridge type %d", p_cartridge->header.type);
+        exit(-1);
+        break;
     }
 
-    return p_cartridge;
+    rtc_init(&p_cartridge->rtc, p_clock);
+
+    size_t save_length = p_cartridge->ram_save_length + (p_cartridge->has_rtc ? RTC_FOOTER_SIZE : 0);
+
+    if (p_cartridge->battery && save_length && save)
+    {
+        /* RAM lives in the mapped save file. */
+        cartridge_open_save(p_cartridge, path);
+    }
+    else if (p_cartridge->battery && save_length)
+    {
+        cartridge_copy_save(p_cartridge, path);
+    }
+    else if (p_cartridge->ram_length)
+    {
+        p_cartridge->ram = calloc(p_cartridge->ram_length, sizeof(uint8_t));
+    }
+
+    if ((p_cartridge->ram_length && !p_cartridge->ram) || (p_cartridge->battery && save_length && save && !p_cartridge->save))
+    {
+        cartridge_unload(p_cartridge);
+        return -1;
+    }
+
+    cartridge_update_banks(p_cartridge);
+
+    return 0;
 }
 
-void cartridge_free(cartridge_t *p_cartridge)
+void cartridge_unload(cartridge_t *p_cartridge)
 {
     if (p_cartridge)
     {
+        if (p_cartridge->save)
+        {
+            cartridge_save_rtc(p_cartridge);
+
+            if (p_cartridge->ram == p_cartridge->save->mem)
+            {
+                p_cartridge->ram = NULL;
+            }
+
+            save_file_close(p_cartridge->save);
+            p_cartridge->save = NULL;
+        }
+
         if (p_cartridge->ram)
         {
             free(p_cartridge->ram);
@@ -78,11 +178,42 @@ void cartridge_free(cartridge_t *p_cartridge)
 
         if (p_cartridge->rom)
         {
-            free(p_cartridge->rom);
+            rom_cache_release(p_cartridge->rom);
             p_cartridge->rom = NULL;
         }
+    }
+}
 
-        free(p_cartridge);
+/* Host side fields are taken from p_host, bank registers stay as they are. */
+void cartridge_rebind(cartridge_t *p_cartridge, const cartridge_t *p_host)
+{
+    if (p_cartridge && p_host)
+    {
+        p_cartridge->rom = p_host->rom;
+        p_cartridge->rom_length = p_host->rom_length;
+        p_cartridge->ram = p_host->ram;
+        p_cartridge->ram_length = p_host->ram_length;
+        p_cartridge->ram_save_length = p_host->ram_save_length;
+        p_cartridge->save = p_host->save;
+        p_cartridge->rumble = p_host->rumble;
+        p_cartridge->p_rumble_context = p_host->p_rumble_context;
+        p_cartridge->rtc.p_clock = p_host->rtc.p_clock;
+
+        p_cartridge->read_rom = p_host->read_rom;
+        p_cartridge->write_rom = p_host->write_rom;
+        p_cartridge->read_ram = p_host->read_ram;
+        p_cartridge->write_ram = p_host->write_ram;
+
+        cartridge_update_banks(p_cartridge);
+    }
+}
+
+void cartridge_set_rumble(cartridge_t *p_cartridge, cartridge_rumble_t rumble, void *p_context)
+{
+    if (p_cartridge)
+    {
+        p_cartridge->rumble = rumble;
+        p_cartridge->p_rumble_context = p_context;
     }
 }
 
@@ -103,51 +234,209 @@ int cartridge_read_ram(cartridge_t *p_cartridge, uint16_t address, uint8_t *data
 
 int cartridge_write_ram(cartridge_t *p_cartridge, uint16_t address, uint8_t data)
 {
-    return p_cartridge->write_ram(p_cartridge, address, data);
+    uint8_t *p_bank = p_cartridge->ram_bank_mem;
+    int ret = p_cartridge->write_ram(p_cartridge, address, data);
+
+    if (p_cartridge->save)
+    {
+        /* RAM allocated apart from the save file is written through. */
+        if (p_bank && (p_cartridge->ram != p_cartridge->save->mem))
+        {
+            size_t offset = (size_t)(p_bank - p_cartridge->ram) + (address - 0xA000);
+            if (offset < p_cartridge->ram_save_length)
+            {
+                p_cartridge->save->mem[offset] = data;
+            }
+        }
+
+        save_file_touch(p_cartridge->save);
+    }
+
+    return ret;
+}
+
+void cartridge_ram_changed(cartridge_t *p_cartridge)
+{
+    if (p_cartridge && p_cartridge->save)
+    {
+        if (p_cartridge->ram != p_cartridge->save->mem)
+        {
+            (void)memcpy(p_cartridge->save->mem, p_cartridge->ram, p_cartridge->ram_save_length);
+        }
+
+        save_file_touch(p_cartridge->save);
+    }
 }
 
 /************************************/
 
-static uint8_t *load_file(char *path, cartridge_header_t *p_header)
+/* Recompute the switchable bank base pointers, out of range banks wrap around. */
+static void cartridge_update_banks(cartridge_t *p_cartridge)
 {
-    FILE *file = fopen(path, "rb");
+    size_t rom_banks = p_cartridge->rom_length / ROM_BANK_SIZE;
+    size_t rom_bank = p_cartridge->rom_bank % rom_banks;
+
+    p_cartridge->rom_bank_mem = p_cartridge->rom + (rom_bank * ROM_BANK_SIZE);
 
-    if (!file)
+    if (p_cartridge->ram_length && p_cartridge->ram_enabled && !p_cartridge->rtc_select)
     {
-        printf("Failed to open file: %s\n", path);
-        return NULL;
+        size_t ram_banks = p_cartridge->ram_length / RAM_BANK_SIZE;
+        size_t ram_bank = p_cartridge->ram_bank % ram_banks;
+
+        p_cartridge->ram_bank_mem = p_cartridge->ram + (ram_bank * RAM_BANK_SIZE);
+    }
+    else
+    {
+        p_cartridge->ram_bank_mem = NULL;
     }
+}
 
-    /* Retrieve file size. */
-    fseek(file, 0, SEEK_END);
-    size_t file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+/* Save file is the ROM path with its extension replaced by .sav */
+static char *make_save_path(const char *rom_path)
+{
+    const char *extension = strrchr(rom_path, '.');
+    const char *separator = strrchr(rom_path, '/');
 
-    if ((file_size < 0x150) || (file_size > 0x800000))
+    size_t length = strlen(rom_path);
+    if (extension && (!separator || (extension > separator)))
     {
-        printf("Invalid file size: %d\n", file_size);
-        fclose(file);
-        return NULL;
+        length = extension - rom_path;
+    }
+
+    char *path = malloc(length + sizeof(".sav"));
+    if (path)
+    {
+        (void)memcpy(path, rom_path, length);
+        (void)strcpy(path + length, ".sav");
     }
 
-    uint8_t *rom = malloc(file_size);
+    return path;
+}
+
+/* Map the save file, RAM first then the RTC footer. */
+static void cartridge_open_save(cartridge_t *p_cartridge, const char *rom_path)
+{
+    char *save_path = make_save_path(rom_path);
+    if (!save_path)
+        return;
+
+    size_t footer_length = p_cartridge->has_rtc ? RTC_FOOTER_SIZE : 0;
+
+    p_cartridge->save = save_file_open(save_path, p_cartridge->ram_save_length + footer_length);
 
-    if (!rom)
+    if (p_cartridge->save)
     {
-        printf("Failed to allocate rom, size %d\n", file_size);
+        /* Banks are mapped whole, RAM smaller than a bank gets its own. */
+        if (p_cartridge->ram_save_length < p_cartridge->ram_length)
+        {
+            p_cartridge->ram = calloc(p_cartridge->ram_length, sizeof(uint8_t));
+            if (p_cartridge->ram)
+            {
+                (void)memcpy(p_cartridge->ram, p_cartridge->save->mem, p_cartridge->ram_save_length);
+            }
+        }
+        else
+        {
+            p_cartridge->ram = p_cartridge->ram_length ? p_cartridge->save->mem : NULL;
+        }
+
+        if (p_cartridge->save->loaded_size)
+        {
+            printf("Loaded save file: %s\n", save_path);
+        }
+
+        if (p_cartridge->has_rtc && (p_cartridge->save->loaded_size > p_cartridge->ram_save_length))
+        {
+            size_t loaded_footer = p_cartridge->save->loaded_size - p_cartridge->ram_save_length;
+            if (loaded_footer > footer_length)
+            {
+                loaded_footer = footer_length;
+            }
+
+            if (rtc_load(&p_cartridge->rtc, p_cartridge->save->mem + p_cartridge->ram_save_length, loaded_footer) < 0)
+            {
+                printf("No RTC data in save file: %s\n", save_path);
+            }
+        }
+    }
+
+    free(save_path);
+}
+
+/* RAM and RTC start from the save file, if any, but are never written back. */
+static void cartridge_copy_save(cartridge_t *p_cartridge, const char *rom_path)
+{
+    size_t footer_length = p_cartridge->has_rtc ? RTC_FOOTER_SIZE : 0;
+
+    uint8_t *copy = calloc(p_cartridge->ram_length + footer_length, sizeof(uint8_t));
+    if (!copy)
+        return;
+
+    char *save_path = make_save_path(rom_path);
+    FILE *file = save_path ? fopen(save_path, "rb") : NULL;
+    size_t loaded_size = 0;
+
+    if (file)
+    {
+        loaded_size = fread(copy, sizeof(uint8_t), p_cartridge->ram_save_length + footer_length, file);
         fclose(file);
-        return NULL;
     }
+    free(save_path);
 
-    (void)fread(rom, file_size, 1, file);
+    if (p_cartridge->has_rtc && (loaded_size > p_cartridge->ram_save_length))
+    {
+        (void)rtc_load(&p_cartridge->rtc, copy + p_cartridge->ram_save_length, loaded_size - p_cartridge->ram_save_length);
+    }
 
-    parse_header(rom, p_header);
+    /* The footer follows the RAM of the file, not the end of the bank. */
+    (void)memset(copy + p_cartridge->ram_save_length, 0, p_cartridge->ram_length + footer_length - p_cartridge->ram_save_length);
 
-    fclose(file);
-    return rom;
+    if (p_cartridge->ram_length)
+    {
+        p_cartridge->ram = copy;
+    }
+    else
+    {
+        free(copy);
+    }
 }
 
-static void parse_header(uint8_t *rom, cartridge_header_t *p_header)
+/* Keep the RTC footer of the save file up to date. */
+static void cartridge_save_rtc(cartridge_t *p_cartridge)
+{
+    if (p_cartridge->save && p_cartridge->has_rtc)
+    {
+        rtc_save(&p_cartridge->rtc, p_cartridge->save->mem + p_cartridge->ram_save_length);
+        save_file_touch(p_cartridge->save);
+    }
+}
+
+/* RAM size from the header code, at least one bank is allocated. */
+static size_t ram_size(uint8_t ram_size_code)
+{
+    switch (ram_size_code)
+    {
+    case 0x01: /* 2 KiB */
+    case 0x02:
+        return RAM_BANK_SIZE;
+    case 0x03:
+        return 4 * RAM_BANK_SIZE;
+    case 0x04:
+        return 16 * RAM_BANK_SIZE;
+    case 0x05:
+        return 8 * RAM_BANK_SIZE;
+    default:
+        return 0;
+    }
+}
+
+/* RAM size in the save file, the actual size of the RAM. */
+static size_t ram_save_size(uint8_t ram_size_code)
+{
+    return (ram_size_code == 0x01) ? 0x800 : ram_size(ram_size_code);
+}
+
+static void parse_header(const uint8_t *rom, cartridge_header_t *p_header)
 {
     (void)memcpy(p_header->title, rom + 0x134, 16);
     p_header->title[16] = '\0';
@@ -176,7 +465,7 @@ static void parse_header(uint8_t *rom, cartridge_header_t *p_header)
 
     p_header->header_checksum = *(rom + 0x14D);
 
-    p_header->global_checksum = *((uint16_t *)(rom + 0x14E));
+    p_header->global_checksum = *((const uint16_t *)(rom + 0x14E));
 }
 
 static int cartridge_read_rom_simple(cartridge_t *p_cartridge, uint16_t address, uint8_t *data)
@@ -193,14 +482,17 @@ static int cartridge_write_rom_simple(cartridge_t *p_cartridge, uint16_t address
 
 static int cartridge_read_ram_simple(cartridge_t *p_cartridge, uint16_t address, uint8_t *data)
 {
-    //TODO
-    *data = p_cartridge->ram[address - 0xA000];
+    *data = p_cartridge->ram_bank_mem ? p_cartridge->ram_bank_mem[address - 0xA000] : 0xFF;
     return 0;
 }
 
 static int cartridge_write_ram_simple(cartridge_t *p_cartridge, uint16_t address, uint8_t data)
 {
-    p_cartridge->ram[address - 0xA000] = data;
+    if (p_cartridge->ram_bank_mem)
+    {
+        p_cartridge->ram_bank_mem[address - 0xA000] = data;
+    }
+    return 0;
 }
 
 static int cartridge_read_rom_mbc1(cartridge_t *p_cartridge, uint16_t address, uint8_t *data)
@@ -212,11 +504,8 @@ static int cartridge_read_rom_mbc1(cartridge_t *p_cartridge, uint16_t address, u
     }
     else
     {
-        uint32_t addr = address - 0x4000;
-        addr += (uint32_t)p_cartridge->rom_bank * (uint32_t)0x4000;
-
         /* Bank n. */
-        *data = p_cartridge->rom[addr];
+        *data = p_cartridge->rom_bank_mem[address - 0x4000];
     }
     return 0;
 }
@@ -268,17 +557,16 @@ static int cartridge_write_rom_mbc1(cartridge_t *p_cartridge, uint16_t address,
 
         //printf("CART: External RAM banking mode %d.\n", p_cartridge->ram_banking_mode);
     }
+
+    cartridge_update_banks(p_cartridge);
     return 0;
 }
 
 static int cartridge_read_ram_mbc1(cartridge_t *p_cartridge, uint16_t address, uint8_t *data)
 {
-    if (p_cartridge->ram_enabled)
+    if (p_cartridge->ram_bank_mem)
     {
-        uint16_t addr = address - 0xA000;
-        addr += (uint16_t)p_cartridge->ram_bank * (uint16_t)0x2000;
-
-        *data = p_cartridge->ram[addr];
+        *data = p_cartridge->ram_bank_mem[address - 0xA000];
     }
     else
     {
@@ -289,12 +577,139 @@ static int cartridge_read_ram_mbc1(cartridge_t *p_cartridge, uint16_t address, u
 
 static int cartridge_write_ram_mbc1(cartridge_t *p_cartridge, uint16_t address, uint8_t data)
 {
-    if (p_cartridge->ram_enabled)
+    if (p_cartridge->ram_bank_mem)
+    {
+        p_cartridge->ram_bank_mem[address - 0xA000] = data;
+    }
+    return 0;
+}
+
+static int cartridge_read_rom_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t *data)
+{
+    if (address < 0x4000)
+    {
+        /* Bank 0. */
+        *data = p_cartridge->rom[address];
+    }
+    else
+    {
+        /* Bank n. */
+        *data = p_cartridge->rom_bank_mem[address - 0x4000];
+    }
+    return 0;
+}
+
+static int cartridge_write_rom_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t data)
+{
+    if (address < 0x2000)
+    {
+        // RAM and RTC enable
+        p_cartridge->ram_enabled = (0x0A == (data & 0x0F));
+    }
+    else if (address < 0x4000)
+    {
+        // ROM bank number
+        data &= 0x7F;
+        if (0 == data)
+        {
+            data = 0x01;
+        }
+        p_cartridge->rom_bank = data;
+    }
+    else if (address < 0x6000)
+    {
+        // RAM bank number or RTC register select
+        if (data <= 0x03)
+        {
+            p_cartridge->ram_bank = data;
+            p_cartridge->rtc_select = 0;
+        }
+        else if (p_cartridge->has_rtc && (data >= RTC_REG_S) && (data <= RTC_REG_DH))
+        {
+            p_cartridge->rtc_select = data;
+        }
+    }
+    else
+    {
+        // Latch clock data on 0x00 then 0x01
+        if (p_cartridge->has_rtc && (0x00 == p_cartridge->rtc_latch) && (0x01 == data))
+        {
+            rtc_latch(&p_cartridge->rtc);
+            cartridge_save_rtc(p_cartridge);
+        }
+        p_cartridge->rtc_latch = data;
+    }
+
+    cartridge_update_banks(p_cartridge);
+    return 0;
+}
+
+/* RAM banks are mapped directly, only disabled RAM and RTC registers get here. */
+static int cartridge_read_ram_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t *data)
+{
+    if (p_cartridge->ram_enabled && p_cartridge->rtc_select)
+    {
+        *data = rtc_read(&p_cartridge->rtc, p_cartridge->rtc_select);
+    }
+    else if (p_cartridge->ram_bank_mem)
+    {
+        *data = p_cartridge->ram_bank_mem[address - 0xA000];
+    }
+    else
     {
-        uint16_t addr = address - 0xA000;
-        addr += (uint16_t)p_cartridge->ram_bank * (uint16_t)0x2000;
+        *data = 0xFF;
+    }
+    return 0;
+}
+
+static int cartridge_write_ram_mbc3(cartridge_t *p_cartridge, uint16_t address, uint8_t data)
+{
+    if (p_cartridge->ram_enabled && p_cartridge->rtc_select)
+    {
+        rtc_write(&p_cartridge->rtc, p_cartridge->rtc_select, data);
+        cartridge_save_rtc(p_cartridge);
+    }
+    else if (p_cartridge->ram_bank_mem)
+    {
+        p_cartridge->ram_bank_mem[address - 0xA000] = data;
+    }
+    return 0;
+}
 
-        p_cartridge->ram[addr] = data;
+static int cartridge_write_rom_mbc5(cartridge_t *p_cartridge, uint16_t address, uint8_t data)
+{
+    if (address < 0x2000)
+    {
+        // RAM enable
+        p_cartridge->ram_enabled = (0x0A == (data & 0x0F));
+    }
+    else if (address < 0x3000)
+    {
+        // ROM bank number, lower 8 bits, bank 0 is allowed
+        p_cartridge->rom_bank = (p_cartridge->rom_bank & 0x100) | data;
+    }
+    else if (address < 0x4000)
+    {
+        // ROM bank number, bit 8
+        p_cartridge->rom_bank = (p_cartridge->rom_bank & 0xFF) | ((uint16_t)(data & 0x01) << 8);
     }
+    else if (address < 0x6000)
+    {
+        // RAM bank number, bit 3 drives the motor on rumble carts
+        if (p_cartridge->has_rumble)
+        {
+            int enabled = (0 != (data & 0x08));
+            if ((enabled != p_cartridge->rumble_enabled) && p_cartridge->rumble)
+            {
+                p_cartridge->rumble(p_cartridge->p_rumble_context, enabled);
+            }
+            p_cartridge->rumble_enabled = enabled;
+
+            data &= 0x07;
+        }
+        p_cartridge->ram_bank = data & 0x0F;
+    }
+
+    cartridge_update_banks(p_cartridge);
     return 0;
 }
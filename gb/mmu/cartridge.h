@@ -1,7 +1,11 @@
 #ifndef CARTRIDGE_H_
 #define CARTRIDGE_H_
 
+#include "rtc.h"
+#include "save_file.h"
+
 #include <stdint.h>
+#include <stddef.h>
 
 /* ROM HEADER
 0x0100 - 0x0103 Entry point.
@@ -73,6 +77,9 @@ typedef struct cartridge_header_s
 
 typedef struct cartridge_s cartridge_t;
 
+/* Host notification of rumble motor state changes. */
+typedef void (*cartridge_rumble_t)(void *p_context, int enabled);
+
 typedef int (*cartridge_read_rom_access_t)(cartridge_t *p_cartridge, uint16_t address, uint8_t *data);
 typedef int (*cartridge_write_rom_access_t)(cartridge_t *p_cartridge, uint16_t address, uint8_t data);
 typedef int (*cartridge_read_ram_access_t)(cartridge_t *p_cartridge, uint16_t address, uint8_t *data);
@@ -82,14 +89,35 @@ typedef struct cartridge_s
 {
     cartridge_header_t header;
 
-    uint8_t *rom;
-    uint8_t *ram;
+    const uint8_t *rom; /* Shared through the ROM cache, read only. */
+    size_t rom_length;
+    uint8_t *ram; /* Sized from the header, NULL without RAM. */
+    size_t ram_length;
+    size_t ram_save_length; /* RAM in the save file, less than a bank for 2 KiB RAM. */
+
+    /* Base of the banks currently mapped at 0x4000 - 0x7FFF and 0xA000 - 0xBFFF,
+    updated on bank switches. ram_bank_mem is NULL while RAM is disabled. */
+    const uint8_t *rom_bank_mem;
+    uint8_t *ram_bank_mem;
 
-    uint8_t rom_bank;
+    uint16_t rom_bank;
     uint8_t ram_bank;
     int ram_banking_mode;
     int ram_enabled;
 
+    int battery;
+    save_file_t *save; /* Backs RAM (and RTC) when battery backed. */
+
+    int has_rtc;
+    uint8_t rtc_select; /* Selected RTC register, 0 when RAM is selected. */
+    uint8_t rtc_latch;  /* Last latch register write. */
+    rtc_t rtc;
+
+    int has_rumble;
+    int rumble_enabled;
+    cartridge_rumble_t rumble;
+    void *p_rumble_context;
+
     cartridge_read_rom_access_t read_rom;
     cartridge_write_rom_access_t write_rom;
     cartridge_read_ram_access_t read_ram;
@@ -97,8 +125,22 @@ typedef struct cartridge_s
 
 } cartridge_t;
 
-cartridge_t *cartridge_allocate(char *path);
-void cartridge_free(cartridge_t *p_cartridge);
+/* Load the ROM at path into p_cartridge, storage is owned by the caller.
+Cartridge RAM is allocated separately, or mapped from the save file next to
+path (RAM smaller than a bank is allocated and written through to the file). Without save, battery backed RAM and RTC are a private copy of the save
+file instead, never written back. p_clock is the emulated clock the RTC time
+derives from. */
+int cartridge_load(cartridge_t *p_cartridge, char *path, const uint64_t *p_clock, int save);
+void cartridge_unload(cartridge_t *p_cartridge);
+
+/* After the state was replaced by a snapshot of the same cartridge, point it
+back to the memory and callbacks of the loaded cartridge p_host. */
+void cartridge_rebind(cartridge_t *p_cartridge, const cartridge_t *p_host);
+
+/* RAM was written as a whole, bring the save file up to date. */
+void cartridge_ram_changed(cartridge_t *p_cartridge);
+
+void cartridge_set_rumble(cartridge_t *p_cartridge, cartridge_rumble_t rumble, void *p_context);
 
 int cartridge_read_rom(cartridge_t *p_cartridge, uint16_t address, uint8_t *data);
 int cartridge_write_rom(cartridge_t *p_cartridge, uint16_t address, uint8_t data);
@@ -1,11 +1,13 @@
 #include "mmu.h"
 
 #include "cartridge.h"
+#include "save_file.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#define DMA_REG (0xFF46)
 #define BOOT_ENABLE_REG (0xFF50)
 
 #define RAM_OFFSET (0x8000)
@@ -13,8 +15,14 @@
 
 #define MEM_SIZE (0x10000)
 
-#define BOOT_SIZE (regions_init[REGION_BOOT].end - regions_init[REGION_BOOT].start + 1)
-#define ROM_SIZE (regions_init[REGION_ROM].end - regions_init[REGION_ROM].start + 1)
+#define ROM_BANK_SIZE (0x4000)
+
+#define DMA_SIZE (0xA0)
+#define DMA_CYCLES (160 * 4)
+
+#define REGION_SIZE(region) (regions[region].end - regions[region].start + 1)
+#define BOOT_SIZE REGION_SIZE(REGION_BOOT)
+#define ROM_SIZE REGION_SIZE(REGION_ROM)
 
 enum region_e
 {
@@ -31,94 +39,112 @@ enum region_e
     REGION_MAX
 };
 
-typedef int (*mmu_read_access_t)(mmu_t *p_mmu, uint16_t address, uint8_t *data);
-typedef int (*mmu_write_access_t)(mmu_t *p_mmu, uint16_t address, uint8_t data);
-
 typedef struct region_s
 {
     uint16_t start;
     uint16_t end;
-    mmu_read_access_t read;
-    mmu_write_access_t write;
 } region_t;
 
-typedef struct mmu_s
-{
-    uint8_t *boot;
-    uint8_t *ram;
-    cartridge_t *cartridge;
-    region_t *regions;
-
-    struct
-    {
-        int enabled;
-        uint16_t source;
-        uint16_t destination;
-        uint16_t offset;
-    } dma;
-
-} mmu_t;
-
-static const region_t regions_init[REGION_MAX] = {
-    {0x0000, 0x00FF, 0, 0}, // Boot ROM
-    {0x0000, 0x7FFF, 0, 0}, // ROM
-    {0x8000, 0x9FFF, 0, 0}, // Video RAM
-    {0xA000, 0xBFFF, 0, 0}, // External Video RAM
-    {0xC000, 0xDFFF, 0, 0}, // RAM
-    {0xE000, 0xFDFF, 0, 0}, // Echo RAM
-    {0xFE00, 0xFE9F, 0, 0}, // OAM RAM
-    {0xFEA0, 0xFEFF, 0, 0}, // Unused
-    {0xFF00, 0xFF7F, 0, 0}, // IO
-    {0xFF80, 0xFFFF, 0, 0}, // HRAM
+static const region_t regions[REGION_MAX] = {
+    {0x0000, 0x00FF}, // Boot ROM
+    {0x0000, 0x7FFF}, // ROM
+    {0x8000, 0x9FFF}, // Video RAM
+    {0xA000, 0xBFFF}, // External Video RAM
+    {0xC000, 0xDFFF}, // RAM
+    {0xE000, 0xFDFF}, // Echo RAM
+    {0xFE00, 0xFE9F}, // OAM RAM
+    {0xFEA0, 0xFEFF}, // Unused
+    {0xFF00, 0xFF7F}, // IO
+    {0xFF80, 0xFFFF}, // HRAM
 };
 
 /*******************************************/
 
 static int load_file(char *path, void *mem, uint16_t size);
 
-static region_t *mmu_find_readable_region(mmu_t *p_mmu, uint16_t address);
-static region_t *mmu_find_writeable_region(mmu_t *p_mmu, uint16_t address);
+static void mmu_map_read(mmu_t *p_mmu, uint16_t start, uint16_t end, const uint8_t *mem, mmu_read_access_t read);
+static void mmu_map_write(mmu_t *p_mmu, uint16_t start, uint16_t end, uint8_t *mem, mmu_write_access_t write);
+static void mmu_map_boot(mmu_t *p_mmu, int enabled);
+static void mmu_map_banks(mmu_t *p_mmu);
+static void mmu_map_cartridge(mmu_t *p_mmu);
+static uint64_t *mmu_dirty_word(mmu_t *p_mmu, int page);
+static page_t *mmu_page_map(mmu_t *p_mmu, int page);
+static void mmu_watch_trap(mmu_t *p_mmu, int page);
+static void mmu_watch_update(mmu_t *p_mmu, int page);
+static void mmu_watch_hit(mmu_t *p_mmu, uint16_t address, mmu_watch_kind_t kind, uint8_t data);
 
-static int mmu_read_boot(mmu_t *p_mmu, uint16_t address, uint8_t *data);
 static int mmu_read_rom(mmu_t *p_mmu, uint16_t address, uint8_t *data);
 static int mmu_write_rom(mmu_t *p_mmu, uint16_t address, uint8_t data);
 static int mmu_read_ext_ram(mmu_t *p_mmu, uint16_t address, uint8_t *data);
 static int mmu_write_ext_ram(mmu_t *p_mmu, uint16_t address, uint8_t data);
-static int mmu_read_ram(mmu_t *p_mmu, uint16_t address, uint8_t *data);
-static int mmu_write_ram(mmu_t *p_mmu, uint16_t address, uint8_t data);
-static int mmu_read_echo_ram(mmu_t *p_mmu, uint16_t address, uint8_t *data);
-static int mmu_write_echo_ram(mmu_t *p_mmu, uint16_t address, uint8_t data);
-static int mmu_read_unused(mmu_t *p_mmu, uint16_t address, uint8_t *data);
-static int mmu_write_unused(mmu_t *p_mmu, uint16_t address, uint8_t data);
+static int mmu_read_oam(mmu_t *p_mmu, uint16_t address, uint8_t *data);
+static int mmu_write_oam(mmu_t *p_mmu, uint16_t address, uint8_t data);
 static int mmu_read_io(mmu_t *p_mmu, uint16_t address, uint8_t *data);
 static int mmu_write_io(mmu_t *p_mmu, uint16_t address, uint8_t data);
 
-static void mmu_print_regions(mmu_t *p_mmu);
+static int mmu_write_dma(void *p_context, uint16_t address, uint8_t data);
+static int mmu_read_dma_locked(mmu_t *p_mmu, uint16_t address, uint8_t *data);
+static int mmu_write_dma_locked(mmu_t *p_mmu, uint16_t address, uint8_t data);
+static void mmu_dma_complete(mmu_t *p_mmu);
+static int mmu_write_boot_enable(void *p_context, uint16_t address, uint8_t data);
+
+static int mmu_read_watch(mmu_t *p_mmu, uint16_t address, uint8_t *data);
+static int mmu_write_watch(mmu_t *p_mmu, uint16_t address, uint8_t data);
+
+static void mmu_print_page(mmu_t *p_mmu, uint16_t address);
 
 /*******************************************/
 
-mmu_t *mmu_allocate(void)
+size_t mmu_arena_size(void)
 {
-    mmu_t *p_mmu = calloc(1, sizeof(mmu_t));
+    return ARENA_SIZE(sizeof(mmu_t)) + ARENA_SIZE(sizeof(cartridge_t)) + ARENA_SIZE(BOOT_SIZE) + ARENA_SIZE(RAM_SIZE) + (2 * ARENA_SIZE(MMU_PAGE_COUNT * sizeof(page_t)));
+}
+
+mmu_t *mmu_allocate(arena_t *p_arena)
+{
+    mmu_t *p_mmu = arena_alloc(p_arena, sizeof(mmu_t));
 
     if (p_mmu)
     {
-        p_mmu->regions = malloc(sizeof(regions_init));
-
-        if (p_mmu->regions)
-        {
-            (void)memcpy(p_mmu->regions, regions_init, sizeof(regions_init));
-        }
-
-        p_mmu->boot = calloc(BOOT_SIZE, sizeof(uint8_t));
-
-        p_mmu->ram = calloc(RAM_SIZE, sizeof(uint8_t));
-
-        if (!p_mmu->regions || !p_mmu->boot || !p_mmu->ram)
+        p_mmu->cartridge_mem = arena_alloc(p_arena, sizeof(cartridge_t));
+
+        /* Memory and the page tables only used while DMA runs or watchpoints are set. */
+        p_mmu->boot = arena_alloc_bulk(p_arena, BOOT_SIZE);
+        p_mmu->ram = arena_alloc_bulk(p_arena, RAM_SIZE);
+        p_mmu->dma.pages = arena_alloc_bulk(p_arena, MMU_PAGE_COUNT * sizeof(page_t));
+        p_mmu->watch.pages = arena_alloc_bulk(p_arena, MMU_PAGE_COUNT * sizeof(page_t));
+
+#ifdef MMU_PROFILE
+        p_mmu->profile = mmu_profile_allocate();
+        int profiled = (NULL != p_mmu->profile);
+#else
+        int profiled = 1;
+#endif
+
+        if (!p_mmu->cartridge_mem || !p_mmu->boot || !p_mmu->ram || !p_mmu->dma.pages || !p_mmu->watch.pages || !profiled)
         {
             mmu_free(p_mmu);
             p_mmu = NULL;
         }
+        else
+        {
+            p_mmu->vram = p_mmu->ram + (regions[REGION_VRAM].start - RAM_OFFSET);
+            p_mmu->oam = p_mmu->ram + (regions[REGION_OAM_RAM].start - RAM_OFFSET);
+            p_mmu->io_mem = p_mmu->ram + (regions[REGION_IO].start - RAM_OFFSET);
+
+            p_mmu->p_pages = p_mmu->pages;
+
+            /* While DMA runs, everything below 0xFF00 is locked. */
+            for (int page = 0; page < MMU_PAGE_COUNT; page++)
+            {
+                p_mmu->dma.pages[page].dirty = &p_mmu->dirty_sink;
+                p_mmu->dma.pages[page].read = mmu_read_dma_locked;
+                p_mmu->dma.pages[page].write = mmu_write_dma_locked;
+            }
+
+            (void)mmu_register_io(p_mmu, DMA_REG, NULL, mmu_write_dma, p_mmu);
+            (void)mmu_register_io(p_mmu, BOOT_ENABLE_REG, NULL, mmu_write_boot_enable, p_mmu);
+        }
     }
 
     return p_mmu;
@@ -131,14 +157,31 @@ int mmu_load(mmu_t *p_mmu, char *rom_path, char *boot_path)
         return -1;
     }
 
-    for (int r = 0; r < REGION_MAX; r++)
+    /* Disallow all accesses. */
+    (void)memset(p_mmu->pages, 0, sizeof(p_mmu->pages));
+    (void)memset(p_mmu->watch.pages, 0, MMU_PAGE_COUNT * sizeof(page_t));
+    for (int page = 0; page < MMU_PAGE_COUNT; page++)
+    {
+        p_mmu->pages[page].dirty = &p_mmu->dirty_sink;
+        p_mmu->watch.pages[page].dirty = &p_mmu->dirty_sink;
+    }
+    p_mmu->p_pages = p_mmu->pages;
+
+    /* Everything is dirty for every view after a load. */
+    (void)memset(p_mmu->dirty, 0xFF, sizeof(p_mmu->dirty));
+    p_mmu->dma.enabled = 0;
+
+    if (p_mmu->cartridge)
     {
-        /* Disallow all accesses. */
-        p_mmu->regions[r].read = NULL;
-        p_mmu->regions[r].write = NULL;
+        cartridge_unload(p_mmu->cartridge);
+        p_mmu->cartridge = NULL;
     }
 
-    p_mmu->cartridge = cartridge_allocate(rom_path);
+    if (0 == cartridge_load(p_mmu->cartridge_mem, rom_path, &p_mmu->clock, !p_mmu->save_disabled))
+    {
+        p_mmu->cartridge = p_mmu->cartridge_mem;
+    }
+    cartridge_set_rumble(p_mmu->cartridge, p_mmu->rumble, p_mmu->p_rumble_context);
 
     int loaded_boot = load_file(boot_path, p_mmu->boot, BOOT_SIZE);
 
@@ -151,11 +194,8 @@ int mmu_load(mmu_t *p_mmu, char *rom_path, char *boot_path)
     if (p_mmu->cartridge)
     {
         printf("MMU loaded ROM from %s\n", rom_path);
-        p_mmu->regions[REGION_ROM].read = mmu_read_rom;
-        p_mmu->regions[REGION_ROM].write = mmu_write_rom;
 
-        p_mmu->regions[REGION_EXT_VRAM].read = mmu_read_ext_ram;
-        p_mmu->regions[REGION_EXT_VRAM].write = mmu_write_ext_ram;
+        mmu_map_cartridge(p_mmu);
 
         printf("ROM header:\n");
         printf("Title:\t%s\n", p_mmu->cartridge->header.title);
@@ -167,48 +207,36 @@ int mmu_load(mmu_t *p_mmu, char *rom_path, char *boot_path)
     if (0 == loaded_boot)
     {
         printf("MMU loaded BOOT ROM from %s\n", boot_path);
-        p_mmu->regions[REGION_BOOT].read = mmu_read_boot;
+        mmu_map_boot(p_mmu, 1);
     }
 
-    p_mmu->regions[REGION_VRAM].read = mmu_read_ram;
-    p_mmu->regions[REGION_VRAM].write = mmu_write_ram;
-    p_mmu->regions[REGION_RAM].read = mmu_read_ram;
-    p_mmu->regions[REGION_RAM].write = mmu_write_ram;
-    p_mmu->regions[REGION_ECHO_RAM].read = mmu_read_echo_ram;
-    p_mmu->regions[REGION_ECHO_RAM].write = mmu_write_echo_ram;
-    p_mmu->regions[REGION_OAM_RAM].read = mmu_read_ram;
-    p_mmu->regions[REGION_OAM_RAM].write = mmu_write_ram;
-    p_mmu->regions[REGION_HRAM].read = mmu_read_ram;
-    p_mmu->regions[REGION_HRAM].write = mmu_write_ram;
-
-    p_mmu->regions[REGION_UNUSED].read = mmu_read_unused;
-    p_mmu->regions[REGION_UNUSED].write = mmu_write_unused;
+    uint8_t *vram = p_mmu->ram + (regions[REGION_VRAM].start - RAM_OFFSET);
+    mmu_map_read(p_mmu, regions[REGION_VRAM].start, regions[REGION_VRAM].end, vram, NULL);
+    mmu_map_write(p_mmu, regions[REGION_VRAM].start, regions[REGION_VRAM].end, vram, NULL);
 
-    p_mmu->regions[REGION_IO].read = mmu_read_io;
-    p_mmu->regions[REGION_IO].write = mmu_write_io;
+    uint8_t *wram = p_mmu->ram + (regions[REGION_RAM].start - RAM_OFFSET);
+    mmu_map_read(p_mmu, regions[REGION_RAM].start, regions[REGION_RAM].end, wram, NULL);
+    mmu_map_write(p_mmu, regions[REGION_RAM].start, regions[REGION_RAM].end, wram, NULL);
 
-    return 0;
-}
+    /* Echo RAM mirrors RAM. */
+    mmu_map_read(p_mmu, regions[REGION_ECHO_RAM].start, regions[REGION_ECHO_RAM].end, wram, NULL);
+    mmu_map_write(p_mmu, regions[REGION_ECHO_RAM].start, regions[REGION_ECHO_RAM].end, wram, NULL);
 
-int mmu_execute(mmu_t *p_mmu)
-{
-    if (p_mmu->dma.enabled)
-    {
-        uint16_t destination = p_mmu->dma.destination + p_mmu->dma.offset;
-        uint16_t source = p_mmu->dma.source + p_mmu->dma.offset;
+    /* OAM RAM and unused area share a page. */
+    mmu_map_read(p_mmu, regions[REGION_OAM_RAM].start, regions[REGION_UNUSED].end, NULL, mmu_read_oam);
+    mmu_map_write(p_mmu, regions[REGION_OAM_RAM].start, regions[REGION_UNUSED].end, NULL, mmu_write_oam);
 
-        uint8_t value;
-        (void)mmu_read_u8(p_mmu, source, &value);
-        (void)mmu_write_u8(p_mmu, destination, value);
+    /* IO registers and HRAM share a page. */
+    mmu_map_read(p_mmu, regions[REGION_IO].start, regions[REGION_HRAM].end, NULL, mmu_read_io);
+    mmu_map_write(p_mmu, regions[REGION_IO].start, regions[REGION_HRAM].end, NULL, mmu_write_io);
 
-        p_mmu->dma.offset += 1;
-        if (p_mmu->dma.offset >= 160)
-        {
-            p_mmu->dma.enabled = 0;
-            //printf("MMU: Finished DMA transfer from 0x%04x to 0x%04x\n", p_mmu->dma.source + p_mmu->dma.offset - 1, p_mmu->dma.destination + p_mmu->dma.offset - 1);
-        }
+    /* Watchpoints survive loading. */
+    for (int page = 0; page < MMU_PAGE_COUNT; page++)
+    {
+        mmu_watch_trap(p_mmu, page);
     }
-    return 1;
+
+    return 0;
 }
 
 int mmu_read_u8(mmu_t *p_mmu, uint16_t address, uint8_t *data)
@@ -216,10 +244,24 @@ int mmu_read_u8(mmu_t *p_mmu, uint16_t address, uint8_t *data)
     if (!p_mmu || !data)
         return -1;
 
-    region_t *p_region = mmu_find_readable_region(p_mmu, address);
-    if (p_region)
+    /* Fetches are counted by mmu_fetch_u8. */
+#ifdef MMU_PROFILE
+    if (!p_mmu->watch.fetching)
+    {
+        MMU_PROFILE_ACCESS(p_mmu, MMU_PROFILE_READ, address);
+    }
+#endif
+
+    page_t *p_page = &p_mmu->p_pages[MMU_PAGE_INDEX(address)];
+    if (p_page->read_mem)
+    {
+        *data = p_page->read_mem[MMU_PAGE_OFFSET(address)];
+        return 0;
+    }
+
+    if (p_page->read)
     {
-        int ret = p_region->read(p_mmu, address, data);
+        int ret = p_page->read(p_mmu, address, data);
         if (ret < 0)
         {
             printf("MMU: Read access failure: 0x%04x\n", address);
@@ -228,7 +270,7 @@ int mmu_read_u8(mmu_t *p_mmu, uint16_t address, uint8_t *data)
     }
 
     printf("MMU: Read access violation: 0x%04x\n", address);
-    mmu_print_regions(p_mmu);
+    mmu_print_page(p_mmu, address);
     exit(-1);
     return -1;
 }
@@ -238,10 +280,19 @@ int mmu_write_u8(mmu_t *p_mmu, uint16_t address, uint8_t data)
     if (!p_mmu)
         return -1;
 
-    region_t *p_region = mmu_find_writeable_region(p_mmu, address);
-    if (p_region)
+    MMU_PROFILE_ACCESS(p_mmu, MMU_PROFILE_WRITE, address);
+
+    page_t *p_page = &p_mmu->p_pages[MMU_PAGE_INDEX(address)];
+    if (p_page->write_mem)
+    {
+        p_page->write_mem[MMU_PAGE_OFFSET(address)] = data;
+        *p_page->dirty |= MMU_DIRTY_MARK(MMU_PAGE_OFFSET(address));
+        return 0;
+    }
+
+    if (p_page->write)
     {
-        int ret = p_region->write(p_mmu, address, data);
+        int ret = p_page->write(p_mmu, address, data);
         if (ret < 0)
         {
             printf("MMU: Write access failure: 0x%04x\n", address);
@@ -250,7 +301,7 @@ int mmu_write_u8(mmu_t *p_mmu, uint16_t address, uint8_t data)
     }
 
     printf("MMU: Write access violation: 0x%04x\n", address);
-    mmu_print_regions(p_mmu);
+    mmu_print_page(p_mmu, address);
     exit(-1);
     return -1;
 }
@@ -293,33 +344,272 @@ int mmu_write_u16(mmu_t *p_mmu, uint16_t address, uint16_t data)
     return 0;
 }
 
-void mmu_free(mmu_t *p_mmu)
+/* Copy the pending OAM DMA transfer, the bus stays locked until it completes. */
+void mmu_dma_sync(mmu_t *p_mmu)
 {
-    if (p_mmu)
+    if (!p_mmu || !p_mmu->dma.enabled || p_mmu->dma.copied)
+        return;
+
+    /* Not a CPU access, watchpoints are bypassed. */
+    page_t *p_page = mmu_page_map(p_mmu, MMU_PAGE_INDEX(p_mmu->dma.source));
+    if (p_page->read_mem)
+    {
+        (void)memcpy(p_mmu->oam, p_page->read_mem, DMA_SIZE);
+    }
+    else
+    {
+        for (uint16_t offset = 0; offset < DMA_SIZE; offset++)
+        {
+            uint8_t value = 0xFF;
+            if (p_page->read)
+            {
+                (void)p_page->read(p_mmu, p_mmu->dma.source + offset, &value);
+            }
+            p_mmu->oam[offset] = value;
+        }
+    }
+
+    p_mmu->dma.copied = 1;
+
+    uint64_t *dirty = mmu_dirty_word(p_mmu, MMU_PAGE_INDEX(regions[REGION_OAM_RAM].start));
+    for (uint16_t offset = 0; offset < DMA_SIZE; offset += MMU_DIRTY_CHUNK_SIZE)
+    {
+        *dirty |= MMU_DIRTY_MARK(offset);
+    }
+}
+
+void mmu_dirty_clear(mmu_t *p_mmu, uint16_t start, uint16_t end, mmu_dirty_view_t view)
+{
+    if (!p_mmu)
+        return;
+
+    uint64_t mask = ~(0x1111111111111111ull << view);
+
+    for (int page = MMU_PAGE_INDEX(start); page <= MMU_PAGE_INDEX(end); page++)
     {
-        if (p_mmu->regions)
+        if (page >= MMU_DIRTY_FIRST_PAGE)
         {
-            free(p_mmu->regions);
-            p_mmu->regions = NULL;
+            p_mmu->dirty[page - MMU_DIRTY_FIRST_PAGE] &= mask;
         }
+    }
+}
 
-        if (p_mmu->boot)
+int mmu_watch_add(mmu_t *p_mmu, uint16_t address, int kinds)
+{
+    if (!p_mmu || !kinds)
+        return -1;
+
+    mmu_watch_t *p_watch = NULL;
+    for (int i = 0; i < p_mmu->watch.count; i++)
+    {
+        if (p_mmu->watch.points[i].address == address)
         {
-            free(p_mmu->boot);
-            p_mmu->boot = NULL;
+            p_watch = &p_mmu->watch.points[i];
+            break;
         }
+    }
+
+    if (!p_watch)
+    {
+        if (p_mmu->watch.count >= MMU_WATCH_MAX)
+        {
+            printf("MMU: Too many watchpoints (%d)\n", MMU_WATCH_MAX);
+            return -1;
+        }
+
+        p_watch = &p_mmu->watch.points[p_mmu->watch.count++];
+        p_watch->address = address;
+        p_watch->kinds = 0;
+    }
 
-        if (p_mmu->ram)
+    p_watch->kinds |= kinds;
+
+    mmu_watch_update(p_mmu, MMU_PAGE_INDEX(address));
+    return 0;
+}
+
+int mmu_watch_remove(mmu_t *p_mmu, uint16_t address, int kinds)
+{
+    if (!p_mmu)
+        return -1;
+
+    for (int i = 0; i < p_mmu->watch.count; i++)
+    {
+        mmu_watch_t *p_watch = &p_mmu->watch.points[i];
+        if (p_watch->address == address)
         {
-            free(p_mmu->ram);
-            p_mmu->ram = NULL;
+            p_watch->kinds &= ~kinds;
+            if (!p_watch->kinds)
+            {
+                *p_watch = p_mmu->watch.points[--p_mmu->watch.count];
+            }
+
+            mmu_watch_update(p_mmu, MMU_PAGE_INDEX(address));
+            return 0;
         }
+    }
+
+    return -1;
+}
+
+void mmu_set_watch_callback(mmu_t *p_mmu, mmu_watch_callback_t callback, void *p_context)
+{
+    if (!p_mmu)
+        return;
+
+    p_mmu->watch.callback = callback;
+    p_mmu->watch.p_context = p_context;
+}
+
+/* Fetch from a page without plain memory, flagged so execute watchpoints can
+tell opcode fetches from operand fetches and data reads. */
+uint8_t mmu_fetch_slow(mmu_t *p_mmu, uint16_t address, mmu_fetch_t fetch)
+{
+    uint8_t data = 0xFF;
+
+    p_mmu->watch.fetching = fetch;
+    (void)mmu_read_u8(p_mmu, address, &data);
+    p_mmu->watch.fetching = MMU_FETCH_NONE;
+
+    return data;
+}
+
+void mmu_invalidate(mmu_t *p_mmu)
+{
+    if (!p_mmu)
+        return;
+
+    (void)memset(p_mmu->dirty, 0xFF, sizeof(p_mmu->dirty));
+
+    if (p_mmu->cartridge && p_mmu->cartridge->save)
+    {
+        save_file_touch(p_mmu->cartridge->save);
+    }
+}
+
+void mmu_host_save(mmu_t *p_mmu, mmu_host_t *p_host)
+{
+    if (!p_mmu || !p_host)
+        return;
+
+    p_host->has_cartridge = (NULL != p_mmu->cartridge);
+    if (p_host->has_cartridge)
+    {
+        p_host->cartridge = *p_mmu->cartridge;
+    }
+
+    p_host->sync = p_mmu->sync;
+    p_host->p_sync_context = p_mmu->p_sync_context;
+    p_host->rumble = p_mmu->rumble;
+    p_host->p_rumble_context = p_mmu->p_rumble_context;
+    p_host->watch_callback = p_mmu->watch.callback;
+    p_host->p_watch_context = p_mmu->watch.p_context;
+#ifdef MMU_PROFILE
+    p_host->profile = p_mmu->profile;
+#endif
+}
+
+/* Cartridge pages of the restored state may point to memory of an earlier load,
+they are mapped again from the bank registers. The boot ROM stays mapped if it
+was. */
+void mmu_host_restore(mmu_t *p_mmu, const mmu_host_t *p_host)
+{
+    if (!p_mmu || !p_host)
+        return;
+
+    p_mmu->sync = p_host->sync;
+    p_mmu->p_sync_context = p_host->p_sync_context;
+    p_mmu->rumble = p_host->rumble;
+    p_mmu->p_rumble_context = p_host->p_rumble_context;
+    p_mmu->watch.callback = p_host->watch_callback;
+    p_mmu->watch.p_context = p_host->p_watch_context;
+#ifdef MMU_PROFILE
+    p_mmu->profile = p_host->profile;
+#endif
+
+    p_mmu->cartridge = p_host->has_cartridge ? p_mmu->cartridge_mem : NULL;
+    if (p_mmu->cartridge)
+    {
+        int boot = (mmu_page_map(p_mmu, MMU_PAGE_INDEX(regions[REGION_BOOT].start))->read_mem == p_mmu->boot);
+
+        cartridge_rebind(p_mmu->cartridge, &p_host->cartridge);
+        mmu_map_cartridge(p_mmu);
+        mmu_map_boot(p_mmu, boot);
+    }
+
+    mmu_invalidate(p_mmu);
+}
+
+int mmu_dump_profile(mmu_t *p_mmu, const char *path)
+{
+    if (!p_mmu)
+        return -1;
+
+#ifdef MMU_PROFILE
+    return mmu_profile_dump(p_mmu->profile, path);
+#else
+    (void)path;
+    printf("MMU: Built without MMU_PROFILE\n");
+    return -1;
+#endif
+}
+
+void mmu_set_save(mmu_t *p_mmu, int enabled)
+{
+    if (!p_mmu)
+        return;
+
+    p_mmu->save_disabled = !enabled;
+}
+
+void mmu_set_rumble(mmu_t *p_mmu, cartridge_rumble_t rumble, void *p_context)
+{
+    if (!p_mmu)
+        return;
+
+    p_mmu->rumble = rumble;
+    p_mmu->p_rumble_context = p_context;
+
+    cartridge_set_rumble(p_mmu->cartridge, rumble, p_context);
+}
+
+int mmu_register_io(mmu_t *p_mmu, uint16_t address, mmu_io_read_t read, mmu_io_write_t write, void *p_context)
+{
+    if (!p_mmu || (address < regions[REGION_IO].start) || (address > regions[REGION_IO].end))
+        return -1;
+
+    io_handler_t *p_handler = &p_mmu->io[MMU_IO_INDEX(address)];
+    p_handler->read = read;
+    p_handler->write = write;
+    p_handler->p_context = p_context;
+
+    return 0;
+}
+
+void mmu_set_sync(mmu_t *p_mmu, mmu_sync_t sync, void *p_context)
+{
+    if (!p_mmu)
+        return;
+
+    p_mmu->sync = sync;
+    p_mmu->p_sync_context = p_context;
+}
 
+/* MMU memory lives in the arena, only the cartridge and profile are released. */
+void mmu_free(mmu_t *p_mmu)
+{
+    if (p_mmu)
+    {
         if (p_mmu->cartridge)
         {
-            cartridge_free(p_mmu->cartridge);
+            cartridge_unload(p_mmu->cartridge);
             p_mmu->cartridge = NULL;
         }
+
+#ifdef MMU_PROFILE
+        mmu_profile_free(p_mmu->profile);
+        p_mmu->profile = NULL;
+#endif
     }
 }
 
@@ -353,38 +643,186 @@ static int load_file(char *path, void *mem, uint16_t size)
     return 0;
 }
 
-static region_t *mmu_find_readable_region(mmu_t *p_mmu, uint16_t address)
+/* Map read accesses of pages [start, end] either to host memory (mem, matching
+address start) or, when mem is NULL, to the read handler. */
+static void mmu_map_read(mmu_t *p_mmu, uint16_t start, uint16_t end, const uint8_t *mem, mmu_read_access_t read)
+{
+    for (int page = MMU_PAGE_INDEX(start); page <= MMU_PAGE_INDEX(end); page++)
+    {
+        page_t *p_page = mmu_page_map(p_mmu, page);
+        p_page->read_mem = mem ? mem + ((page * MMU_PAGE_SIZE) - start) : NULL;
+        p_page->read = read;
+
+        mmu_watch_trap(p_mmu, page);
+    }
+}
+
+/* Map write accesses of pages [start, end] either to host memory (mem, matching
+address start) or, when mem is NULL, to the write handler. */
+static void mmu_map_write(mmu_t *p_mmu, uint16_t start, uint16_t end, uint8_t *mem, mmu_write_access_t write)
+{
+    for (int page = MMU_PAGE_INDEX(start); page <= MMU_PAGE_INDEX(end); page++)
+    {
+        page_t *p_page = mmu_page_map(p_mmu, page);
+        p_page->write_mem = mem ? mem + ((page * MMU_PAGE_SIZE) - start) : NULL;
+        p_page->dirty = mmu_dirty_word(p_mmu, page);
+        p_page->write = write;
+
+        mmu_watch_trap(p_mmu, page);
+    }
+}
+
+/* Dirty word of a page, echo RAM shares the RAM words.
+ROM and external RAM are not tracked. */
+static uint64_t *mmu_dirty_word(mmu_t *p_mmu, int page)
+{
+    if ((page < MMU_DIRTY_FIRST_PAGE) || ((page >= MMU_PAGE_INDEX(regions[REGION_EXT_VRAM].start)) && (page <= MMU_PAGE_INDEX(regions[REGION_EXT_VRAM].end))))
+    {
+        return &p_mmu->dirty_sink;
+    }
+
+    if ((page >= MMU_PAGE_INDEX(regions[REGION_ECHO_RAM].start)) && (page <= MMU_PAGE_INDEX(regions[REGION_ECHO_RAM].end)))
+    {
+        page -= MMU_PAGE_INDEX(regions[REGION_ECHO_RAM].start - regions[REGION_RAM].start);
+    }
+
+    return &p_mmu->dirty[page - MMU_DIRTY_FIRST_PAGE];
+}
+
+/* Page entry holding the actual mapping, moved aside while the page is trapped. */
+static page_t *mmu_page_map(mmu_t *p_mmu, int page)
+{
+    return p_mmu->watch.traps[page] ? &p_mmu->watch.pages[page] : &p_mmu->pages[page];
+}
+
+/* Rebuild the page entry of a trapped page from its actual mapping.
+Trapped accesses go through the watch handlers, the others stay direct. */
+static void mmu_watch_trap(mmu_t *p_mmu, int page)
+{
+    int traps = p_mmu->watch.traps[page];
+    if (!traps)
+        return;
+
+    page_t *p_page = &p_mmu->pages[page];
+    *p_page = p_mmu->watch.pages[page];
+
+    if (traps & (MMU_WATCH_READ | MMU_WATCH_EXECUTE))
+    {
+        p_page->read_mem = NULL;
+        p_page->read = mmu_read_watch;
+    }
+
+    if (traps & MMU_WATCH_WRITE)
+    {
+        p_page->write_mem = NULL;
+        p_page->write = mmu_write_watch;
+    }
+
+    /* IO page is shared with the DMA page table. */
+    if (page == MMU_PAGE_INDEX(regions[REGION_IO].start))
+    {
+        p_mmu->dma.pages[page] = *p_page;
+    }
+}
+
+/* Trap or release a page after its watchpoints changed. */
+static void mmu_watch_update(mmu_t *p_mmu, int page)
 {
-    for (int r = 0; r < REGION_MAX; r++)
+    int traps = 0;
+    for (int i = 0; i < p_mmu->watch.count; i++)
     {
-        region_t *p_region = p_mmu->regions + r;
-        if (p_region->read && (p_region->start <= address) && (address <= p_region->end))
+        if (MMU_PAGE_INDEX(p_mmu->watch.points[i].address) == page)
         {
-            return p_region;
+            traps |= p_mmu->watch.points[i].kinds;
         }
     }
 
-    return NULL;
+    if (!p_mmu->watch.traps[page] && traps)
+    {
+        p_mmu->watch.pages[page] = p_mmu->pages[page];
+    }
+    else if (p_mmu->watch.traps[page] && !traps)
+    {
+        p_mmu->pages[page] = p_mmu->watch.pages[page];
+        if (page == MMU_PAGE_INDEX(regions[REGION_IO].start))
+        {
+            p_mmu->dma.pages[page] = p_mmu->pages[page];
+        }
+    }
+
+    p_mmu->watch.traps[page] = (uint8_t)traps;
+    mmu_watch_trap(p_mmu, page);
 }
 
-static region_t *mmu_find_writeable_region(mmu_t *p_mmu, uint16_t address)
+static void mmu_watch_hit(mmu_t *p_mmu, uint16_t address, mmu_watch_kind_t kind, uint8_t data)
 {
-    for (int r = 0; r < REGION_MAX; r++)
+    for (int i = 0; i < p_mmu->watch.count; i++)
     {
-        region_t *p_region = p_mmu->regions + r;
-        if (p_region->write && (p_region->start <= address) && (address <= p_region->end))
+        mmu_watch_t *p_watch = &p_mmu->watch.points[i];
+        if ((p_watch->address == address) && (p_watch->kinds & kind))
         {
-            return p_region;
+            if (p_mmu->watch.callback)
+            {
+                p_mmu->watch.callback(p_mmu->watch.p_context, address, kind, data);
+            }
+            return;
         }
     }
+}
+
+/* Boot ROM overlays the first ROM page for reads only. */
+static void mmu_map_boot(mmu_t *p_mmu, int enabled)
+{
+    uint16_t start = regions[REGION_BOOT].start;
+    uint16_t end = regions[REGION_BOOT].end;
+
+    if (enabled)
+    {
+        mmu_map_read(p_mmu, start, end, p_mmu->boot, NULL);
+    }
+    else if (p_mmu->cartridge)
+    {
+        mmu_map_read(p_mmu, start, end, p_mmu->cartridge->rom + start, NULL);
+    }
+    else
+    {
+        mmu_map_read(p_mmu, start, end, NULL, NULL);
+    }
+}
 
-    return NULL;
+/* Map the ROM and external RAM pages of the loaded cartridge. */
+static void mmu_map_cartridge(mmu_t *p_mmu)
+{
+    /* Bank 0 is never switched, read it directly. */
+    mmu_map_read(p_mmu, regions[REGION_ROM].start, ROM_BANK_SIZE - 1, p_mmu->cartridge->rom, NULL);
+    mmu_map_write(p_mmu, regions[REGION_ROM].start, regions[REGION_ROM].end, NULL, mmu_write_rom);
+
+    /* Switchable banks are read directly from the current bank pointers. */
+    mmu_map_read(p_mmu, ROM_BANK_SIZE, regions[REGION_ROM].end, NULL, mmu_read_rom);
+    mmu_map_read(p_mmu, regions[REGION_EXT_VRAM].start, regions[REGION_EXT_VRAM].end, NULL, mmu_read_ext_ram);
+    mmu_map_write(p_mmu, regions[REGION_EXT_VRAM].start, regions[REGION_EXT_VRAM].end, NULL, mmu_write_ext_ram);
+    mmu_map_banks(p_mmu);
 }
 
-static int mmu_read_boot(mmu_t *p_mmu, uint16_t address, uint8_t *data)
+/* Follow cartridge bank switches, pages are only remapped when a bank changed.
+Without a mapped RAM bank the external RAM pages fall back to the handlers. */
+static void mmu_map_banks(mmu_t *p_mmu)
 {
-    *data = p_mmu->boot[address];
-    return 0;
+    cartridge_t *p_cartridge = p_mmu->cartridge;
+
+    uint16_t rom_start = ROM_BANK_SIZE;
+    if (mmu_page_map(p_mmu, MMU_PAGE_INDEX(rom_start))->read_mem != p_cartridge->rom_bank_mem)
+    {
+        mmu_map_read(p_mmu, rom_start, regions[REGION_ROM].end, p_cartridge->rom_bank_mem, mmu_read_rom);
+    }
+
+    /* Battery backed RAM writes go through the cartridge to flag the save dirty. */
+    uint16_t ram_start = regions[REGION_EXT_VRAM].start;
+    if (mmu_page_map(p_mmu, MMU_PAGE_INDEX(ram_start))->read_mem != p_cartridge->ram_bank_mem)
+    {
+        mmu_map_read(p_mmu, ram_start, regions[REGION_EXT_VRAM].end, p_cartridge->ram_bank_mem, mmu_read_ext_ram);
+        mmu_map_write(p_mmu, ram_start, regions[REGION_EXT_VRAM].end, p_cartridge->save ? NULL : p_cartridge->ram_bank_mem, mmu_write_ext_ram);
+    }
 }
 
 static int mmu_read_rom(mmu_t *p_mmu, uint16_t address, uint8_t *data)
@@ -394,7 +832,17 @@ static int mmu_read_rom(mmu_t *p_mmu, uint16_t address, uint8_t *data)
 
 static int mmu_write_rom(mmu_t *p_mmu, uint16_t address, uint8_t data)
 {
-    return cartridge_write_rom(p_mmu->cartridge, address, data);
+    int ret = cartridge_write_rom(p_mmu->cartridge, address, data);
+
+    mmu_map_banks(p_mmu);
+
+    /* The CPU leaves its batch, translated code must not run past a bank switch. */
+    if (p_mmu->sync)
+    {
+        p_mmu->sync(p_mmu->p_sync_context, 1);
+    }
+
+    return ret;
 }
 
 static int mmu_read_ext_ram(mmu_t *p_mmu, uint16_t address, uint8_t *data)
@@ -407,86 +855,200 @@ static int mmu_write_ext_ram(mmu_t *p_mmu, uint16_t address, uint8_t data)
     return cartridge_write_ram(p_mmu->cartridge, address, data);
 }
 
-static int mmu_read_ram(mmu_t *p_mmu, uint16_t address, uint8_t *data)
+static int mmu_read_oam(mmu_t *p_mmu, uint16_t address, uint8_t *data)
 {
+    if (address > regions[REGION_OAM_RAM].end)
+    {
+        /* Unused. */
+        *data = 0xFF;
+        return 0;
+    }
+
     *data = p_mmu->ram[address - RAM_OFFSET];
     return 0;
 }
 
-static int mmu_write_ram(mmu_t *p_mmu, uint16_t address, uint8_t data)
+static int mmu_write_oam(mmu_t *p_mmu, uint16_t address, uint8_t data)
 {
+    if (address > regions[REGION_OAM_RAM].end)
+    {
+        /* Unused, ignore. */
+        return 0;
+    }
+
     p_mmu->ram[address - RAM_OFFSET] = data;
+    p_mmu->dirty[MMU_PAGE_INDEX(address) - MMU_DIRTY_FIRST_PAGE] |= MMU_DIRTY_MARK(MMU_PAGE_OFFSET(address));
     return 0;
 }
 
-static int mmu_read_echo_ram(mmu_t *p_mmu, uint16_t address, uint8_t *data)
+/* IO registers are dispatched to the owning component, registers without
+handler and HRAM are plain memory. */
+static int mmu_read_io(mmu_t *p_mmu, uint16_t address, uint8_t *data)
 {
-    *data = p_mmu->ram[(address - 0x2000) - RAM_OFFSET];
+    if (address <= regions[REGION_IO].end)
+    {
+        if (p_mmu->sync)
+        {
+            p_mmu->sync(p_mmu->p_sync_context, 0);
+        }
+
+        io_handler_t *p_handler = &p_mmu->io[MMU_IO_INDEX(address)];
+        if (p_handler->read)
+        {
+            return p_handler->read(p_handler->p_context, address, data);
+        }
+    }
+
+    *data = p_mmu->io_mem[MMU_PAGE_OFFSET(address)];
     return 0;
 }
 
-static int mmu_write_echo_ram(mmu_t *p_mmu, uint16_t address, uint8_t data)
+static int mmu_write_io(mmu_t *p_mmu, uint16_t address, uint8_t data)
 {
-    p_mmu->ram[(address - 0x2000) - RAM_OFFSET] = data;
+    p_mmu->dirty[MMU_PAGE_INDEX(address) - MMU_DIRTY_FIRST_PAGE] |= MMU_DIRTY_MARK(MMU_PAGE_OFFSET(address));
+
+    if (p_mmu->sync && ((address <= regions[REGION_IO].end) || (address == regions[REGION_HRAM].end)))
+    {
+        p_mmu->sync(p_mmu->p_sync_context, 1);
+    }
+
+    if (address <= regions[REGION_IO].end)
+    {
+        io_handler_t *p_handler = &p_mmu->io[MMU_IO_INDEX(address)];
+        if (p_handler->write)
+        {
+            return p_handler->write(p_handler->p_context, address, data);
+        }
+    }
+
+    p_mmu->io_mem[MMU_PAGE_OFFSET(address)] = data;
     return 0;
 }
 
-static int mmu_read_unused(mmu_t *p_mmu, uint16_t address, uint8_t *data)
+static int mmu_write_dma(void *p_context, uint16_t address, uint8_t data)
 {
-    *data = 0xFF;
+    mmu_t *p_mmu = p_context;
+
+    if (p_mmu->dma.enabled)
+    {
+        /* Restarted, finish the current transfer first. */
+        mmu_dma_complete(p_mmu);
+    }
+
+    p_mmu->dma.enabled = 1;
+    p_mmu->dma.copied = 0;
+    p_mmu->dma.source = (uint16_t)data << 8;
+    p_mmu->dma.end = p_mmu->clock + DMA_CYCLES;
+
+    /* Lock the bus, only IO registers and HRAM stay accessible. */
+    p_mmu->dma.pages[MMU_PAGE_INDEX(regions[REGION_IO].start)] = p_mmu->pages[MMU_PAGE_INDEX(regions[REGION_IO].start)];
+    p_mmu->p_pages = p_mmu->dma.pages;
+
+    mmu_io_set(p_mmu, address, data);
     return 0;
 }
 
-static int mmu_write_unused(mmu_t *p_mmu, uint16_t address, uint8_t data)
+static int mmu_read_dma_locked(mmu_t *p_mmu, uint16_t address, uint8_t *data)
 {
-    //Ignore.
+    if (p_mmu->clock >= p_mmu->dma.end)
+    {
+        mmu_dma_complete(p_mmu);
+        return mmu_read_u8(p_mmu, address, data);
+    }
+
+    *data = 0xFF;
     return 0;
 }
 
-static int mmu_read_io(mmu_t *p_mmu, uint16_t address, uint8_t *data)
+static int mmu_write_dma_locked(mmu_t *p_mmu, uint16_t address, uint8_t data)
 {
-    *data = p_mmu->ram[address - RAM_OFFSET];
+    if (p_mmu->clock >= p_mmu->dma.end)
+    {
+        mmu_dma_complete(p_mmu);
+        return mmu_write_u8(p_mmu, address, data);
+    }
+
+    /* Ignored. */
     return 0;
 }
 
-static int mmu_write_io(mmu_t *p_mmu, uint16_t address, uint8_t data)
+static void mmu_dma_complete(mmu_t *p_mmu)
 {
-    switch (address)
-    {
-    case 0xFF46:
-        if (!p_mmu->dma.enabled)
-        {
-            p_mmu->dma.enabled = 1;
-            p_mmu->dma.offset = 0;
-            p_mmu->dma.source = data;
-            p_mmu->dma.source <= 8;
-            p_mmu->dma.destination = 0xFE00;
-
-            //printf("MMU: Starting DMA transfer from 0x%04x to 0x%04x\n", p_mmu->dma.source, p_mmu->dma.destination);
-            //exit(-1);
-        }
-        break;
+    mmu_dma_sync(p_mmu);
 
-    case 0xFF50:
-        if (data)
-        {
-            p_mmu->regions[REGION_BOOT].read = NULL;
-        }
-        break;
+    p_mmu->dma.enabled = 0;
+    p_mmu->p_pages = p_mmu->pages;
+}
+
+static int mmu_write_boot_enable(void *p_context, uint16_t address, uint8_t data)
+{
+    mmu_t *p_mmu = p_context;
 
-    default:
-        break;
+    if (data)
+    {
+        mmu_map_boot(p_mmu, 0);
     }
 
-    p_mmu->ram[address - RAM_OFFSET] = data;
+    mmu_io_set(p_mmu, address, data);
     return 0;
 }
 
-static void mmu_print_regions(mmu_t *p_mmu)
+/* Watched page accesses, report watched addresses then perform the access
+through the actual mapping. */
+static int mmu_read_watch(mmu_t *p_mmu, uint16_t address, uint8_t *data)
+{
+    page_t *p_page = &p_mmu->watch.pages[MMU_PAGE_INDEX(address)];
+    int ret = -1;
+
+    /* Open bus without memory or handler. */
+    *data = 0xFF;
+
+    if (p_page->read_mem)
+    {
+        *data = p_page->read_mem[MMU_PAGE_OFFSET(address)];
+        ret = 0;
+    }
+    else if (p_page->read)
+    {
+        ret = p_page->read(p_mmu, address, data);
+    }
+
+    if (p_mmu->watch.fetching == MMU_FETCH_OPCODE)
+    {
+        mmu_watch_hit(p_mmu, address, MMU_WATCH_EXECUTE, *data);
+    }
+    else if (p_mmu->watch.fetching == MMU_FETCH_NONE)
+    {
+        mmu_watch_hit(p_mmu, address, MMU_WATCH_READ, *data);
+    }
+
+    return ret;
+}
+
+static int mmu_write_watch(mmu_t *p_mmu, uint16_t address, uint8_t data)
 {
-    for (int r = 0; r < REGION_MAX; r++)
+    page_t *p_page = &p_mmu->watch.pages[MMU_PAGE_INDEX(address)];
+
+    mmu_watch_hit(p_mmu, address, MMU_WATCH_WRITE, data);
+
+    if (p_page->write_mem)
     {
-        region_t *p_region = p_mmu->regions + r;
-        printf("MMU: Region %d [0x%04x - 0x%04x] [R%d W%d]\n", r, p_region->start, p_region->end, p_region->read != 0, p_region->write != 0);
+        p_page->write_mem[MMU_PAGE_OFFSET(address)] = data;
+        *p_page->dirty |= MMU_DIRTY_MARK(MMU_PAGE_OFFSET(address));
+        return 0;
     }
+
+    if (p_page->write)
+    {
+        return p_page->write(p_mmu, address, data);
+    }
+
+    return -1;
+}
+
+static void mmu_print_page(mmu_t *p_mmu, uint16_t address)
+{
+    page_t *p_page = &p_mmu->p_pages[MMU_PAGE_INDEX(address)];
+    printf("MMU: Page 0x%02x [0x%04x - 0x%04x] [R%d W%d]\n", MMU_PAGE_INDEX(address), MMU_PAGE_INDEX(address) * MMU_PAGE_SIZE, (MMU_PAGE_INDEX(address) * MMU_PAGE_SIZE) + MMU_PAGE_SIZE - 1,
+           (p_page->read_mem || p_page->read), (p_page->write_mem || p_page->write));
 }
@@ -1,14 +1,17 @@
 #ifndef MMU_H_
 #define MMU_H_
 
+#include "mmu_def.h"
+#include "../arena.h"
+
 #include <stdint.h>
+#include <assert.h>
 
-typedef struct mmu_s mmu_t;
+size_t mmu_arena_size(void);
 
-mmu_t *mmu_allocate(void);
+mmu_t *mmu_allocate(arena_t *p_arena);
 
 int mmu_load(mmu_t *p_mmu, char *rom_path, char *boot_path);
-int mmu_execute(mmu_t *p_mmu);
 
 int mmu_read_u8(mmu_t *p_mmu, uint16_t address, uint8_t *data);
 int mmu_write_u8(mmu_t *p_mmu, uint16_t address, uint8_t data);
@@ -16,6 +19,163 @@ int mmu_write_u8(mmu_t *p_mmu, uint16_t address, uint8_t data);
 int mmu_read_u16(mmu_t *p_mmu, uint16_t address, uint16_t *data);
 int mmu_write_u16(mmu_t *p_mmu, uint16_t address, uint16_t data);
 
+void mmu_dma_sync(mmu_t *p_mmu);
+
+/* Battery backed cartridges loaded afterwards use their save file, enabled by
+default. Disabled, they work on a private copy of it. */
+void mmu_set_save(mmu_t *p_mmu, int enabled);
+
+void mmu_set_rumble(mmu_t *p_mmu, cartridge_rumble_t rumble, void *p_context);
+
+int mmu_register_io(mmu_t *p_mmu, uint16_t address, mmu_io_read_t read, mmu_io_write_t write, void *p_context);
+
+/* Components running behind the CPU catch up in sync before IO registers (and IE)
+are accessed, write is set when the access may move their next event. */
+void mmu_set_sync(mmu_t *p_mmu, mmu_sync_t sync, void *p_context);
+
+/* Watchpoints, kinds is a combination of mmu_watch_kind_t.
+Only the pages holding a watched address are slowed down. */
+int mmu_watch_add(mmu_t *p_mmu, uint16_t address, int kinds);
+int mmu_watch_remove(mmu_t *p_mmu, uint16_t address, int kinds);
+void mmu_set_watch_callback(mmu_t *p_mmu, mmu_watch_callback_t callback, void *p_context);
+
+uint8_t mmu_fetch_slow(mmu_t *p_mmu, uint16_t address, mmu_fetch_t fetch);
+
+/* Flag all memory changed, after the state was replaced as a whole. */
+void mmu_invalidate(mmu_t *p_mmu);
+
+/* Snapshot restores, the host state is saved before the MMU state is replaced
+and rebound afterwards. Both states must be of the same cartridge. */
+void mmu_host_save(mmu_t *p_mmu, mmu_host_t *p_host);
+void mmu_host_restore(mmu_t *p_mmu, const mmu_host_t *p_host);
+
+/* Write the access heat map, fails unless built with MMU_PROFILE. */
+int mmu_dump_profile(mmu_t *p_mmu, const char *path);
+
 void mmu_free(mmu_t *p_mmu);
 
-#endif /*MMU_H_*/
\ No newline at end of file
+/* Access counting, compiled out unless MMU_PROFILE is defined. */
+#ifdef MMU_PROFILE
+static inline void mmu_profile_access(mmu_t *p_mmu, mmu_profile_access_t access, uint16_t address)
+{
+    int bank = ((address >= 0x4000) && (address < 0x8000) && p_mmu->cartridge) ? p_mmu->cartridge->rom_bank : 0;
+    mmu_profile_count(p_mmu->profile, access, address, bank);
+}
+#define MMU_PROFILE_ACCESS(p_mmu, access, address) mmu_profile_access(p_mmu, access, address)
+#else
+#define MMU_PROFILE_ACCESS(p_mmu, access, address)
+#endif
+
+/* Instruction and operand fetch.
+Plain memory pages are read in place, other pages fall back to mmu_fetch_slow.
+Arguments are only checked in debug builds. */
+
+static inline uint8_t mmu_fetch(mmu_t *p_mmu, uint16_t address, mmu_fetch_t fetch)
+{
+    assert(p_mmu);
+
+    MMU_PROFILE_ACCESS(p_mmu, MMU_PROFILE_FETCH, address);
+
+    const uint8_t *mem = p_mmu->p_pages[MMU_PAGE_INDEX(address)].read_mem;
+    if (mem)
+    {
+        return mem[MMU_PAGE_OFFSET(address)];
+    }
+
+    return mmu_fetch_slow(p_mmu, address, fetch);
+}
+
+/* Opcode byte. */
+static inline uint8_t mmu_fetch_u8(mmu_t *p_mmu, uint16_t address)
+{
+    return mmu_fetch(p_mmu, address, MMU_FETCH_OPCODE);
+}
+
+/* Immediate operands. */
+static inline uint8_t mmu_fetch_operand_u8(mmu_t *p_mmu, uint16_t address)
+{
+    return mmu_fetch(p_mmu, address, MMU_FETCH_OPERAND);
+}
+
+static inline uint16_t mmu_fetch_operand_u16(mmu_t *p_mmu, uint16_t address)
+{
+    uint16_t lsb = mmu_fetch_operand_u8(p_mmu, address);
+    uint16_t msb = mmu_fetch_operand_u8(p_mmu, address + 1);
+
+    return ((msb << 8) | lsb);
+}
+
+/* Raw IO register access.
+Used by the components owning the registers, bypasses the IO handlers. */
+
+static inline uint8_t mmu_io_get(mmu_t *p_mmu, uint16_t address)
+{
+    return p_mmu->io_mem[MMU_PAGE_OFFSET(address)];
+}
+
+static inline void mmu_io_set(mmu_t *p_mmu, uint16_t address, uint8_t value)
+{
+    p_mmu->io_mem[MMU_PAGE_OFFSET(address)] = value;
+}
+
+/* Dirty tracking.
+Writes to VRAM, WRAM (and its echo), OAM and 0xFF00 - 0xFFFF mark the 16 bytes
+chunk they hit for every view. Consumers test and clear their own view. */
+
+/* Mask of the dirty 16 bytes chunks of the page holding address, bit n is chunk n. */
+static inline uint16_t mmu_dirty_chunks(mmu_t *p_mmu, uint16_t address, mmu_dirty_view_t view)
+{
+    if (MMU_PAGE_INDEX(address) < MMU_DIRTY_FIRST_PAGE)
+        return 0;
+
+    uint64_t dirty = p_mmu->dirty[MMU_PAGE_INDEX(address) - MMU_DIRTY_FIRST_PAGE] >> view;
+
+    uint16_t chunks = 0;
+    for (int chunk = 0; dirty; chunk++, dirty >>= MMU_DIRTY_VIEWS)
+    {
+        chunks |= (uint16_t)((dirty & 0x01) << chunk);
+    }
+
+    return chunks;
+}
+
+static inline int mmu_dirty_test(mmu_t *p_mmu, uint16_t address, mmu_dirty_view_t view)
+{
+    if (MMU_PAGE_INDEX(address) < MMU_DIRTY_FIRST_PAGE)
+        return 0;
+
+    return (0 != (p_mmu->dirty[MMU_PAGE_INDEX(address) - MMU_DIRTY_FIRST_PAGE] & (MMU_DIRTY_MARK(MMU_PAGE_OFFSET(address)) & (0x1111111111111111ull << view))));
+}
+
+/* Tile n of VRAM tile data, 0x8000 - 0x97FF. */
+static inline int mmu_dirty_test_tile(mmu_t *p_mmu, int tile, mmu_dirty_view_t view)
+{
+    return mmu_dirty_test(p_mmu, 0x8000 + (tile * MMU_DIRTY_CHUNK_SIZE), view);
+}
+
+/* Clear view for all chunks of pages [start, end]. */
+void mmu_dirty_clear(mmu_t *p_mmu, uint16_t start, uint16_t end, mmu_dirty_view_t view);
+
+static inline void mmu_advance(mmu_t *p_mmu, int cycles)
+{
+    p_mmu->clock += cycles;
+}
+
+/* PPU side access to VRAM and OAM, not subject to CPU bus locking. */
+
+static inline uint8_t mmu_vram_read(mmu_t *p_mmu, uint16_t address)
+{
+    return p_mmu->vram[(address - 0x8000) & 0x1FFF];
+}
+
+static inline uint8_t mmu_oam_read(mmu_t *p_mmu, uint16_t address)
+{
+    if (p_mmu->dma.enabled && !p_mmu->dma.copied)
+    {
+        mmu_dma_sync(p_mmu);
+    }
+
+    return p_mmu->oam[(address - 0xFE00) & 0xFF];
+}
+
+#endif /*MMU_H_*/
@@ -0,0 +1,171 @@
+#ifndef MMU_DEF_H_
+#define MMU_DEF_H_
+
+#include "cartridge.h"
+#include "mmu_profile.h"
+
+#include <stdint.h>
+
+#define MMU_PAGE_SIZE (0x100)
+#define MMU_PAGE_COUNT (0x10000 / MMU_PAGE_SIZE)
+#define MMU_PAGE_INDEX(address) ((address) >> 8)
+#define MMU_PAGE_OFFSET(address) ((address)&0xFF)
+
+/* Dirty tracking covers pages 0x80 - 0xFF, one word per page.
+Each 16 bytes chunk (a tile in VRAM) owns 4 bits, one per view, so marking a
+write sets the bits of all views at once. */
+#define MMU_DIRTY_FIRST_PAGE (0x80)
+#define MMU_DIRTY_PAGES (MMU_PAGE_COUNT - MMU_DIRTY_FIRST_PAGE)
+#define MMU_DIRTY_CHUNK_SIZE (16)
+#define MMU_DIRTY_VIEWS (4)
+#define MMU_DIRTY_MARK(offset) (0xFull << (((offset) >> 4) * MMU_DIRTY_VIEWS))
+
+#define MMU_WATCH_MAX (32)
+
+#define MMU_IO_START (0xFF00)
+#define MMU_IO_COUNT (0x80)
+#define MMU_IO_INDEX(address) ((address)-MMU_IO_START)
+
+typedef struct mmu_s mmu_t;
+
+typedef int (*mmu_read_access_t)(mmu_t *p_mmu, uint16_t address, uint8_t *data);
+typedef int (*mmu_write_access_t)(mmu_t *p_mmu, uint16_t address, uint8_t data);
+
+/* IO register callbacks, owned by the component implementing the register.
+p_context is the component registering the callback. */
+typedef int (*mmu_io_read_t)(void *p_context, uint16_t address, uint8_t *data);
+typedef int (*mmu_io_write_t)(void *p_context, uint16_t address, uint8_t data);
+
+/* Called before the CPU writes an IO register. */
+typedef void (*mmu_sync_t)(void *p_context, int write);
+
+typedef struct io_handler_s
+{
+    mmu_io_read_t read;
+    mmu_io_write_t write;
+    void *p_context;
+} io_handler_t;
+
+/* Watchpoint access kinds, combined as flags. */
+typedef enum mmu_watch_kind_e
+{
+    MMU_WATCH_READ = 0x01,
+    MMU_WATCH_WRITE = 0x02,
+    MMU_WATCH_EXECUTE = 0x04
+} mmu_watch_kind_t;
+
+/* CPU fetch in progress. Execute watchpoints match opcode bytes only, operand
+bytes are neither an instruction start nor a data read. */
+typedef enum mmu_fetch_e
+{
+    MMU_FETCH_NONE = 0,
+    MMU_FETCH_OPCODE,
+    MMU_FETCH_OPERAND
+} mmu_fetch_t;
+
+/* Called when a watched address is accessed, before writes and after reads. */
+typedef void (*mmu_watch_callback_t)(void *p_context, uint16_t address, mmu_watch_kind_t kind, uint8_t data);
+
+typedef struct mmu_watch_s
+{
+    uint16_t address;
+    int kinds;
+} mmu_watch_t;
+
+/* Consumers of the dirty bits, each clears its own view. */
+typedef enum mmu_dirty_view_e
+{
+    MMU_DIRTY_PPU = 0,
+    MMU_DIRTY_SNAPSHOT,
+    MMU_DIRTY_DEBUG,
+    MMU_DIRTY_CODE
+} mmu_dirty_view_t;
+
+/* One entry per 256 bytes page of the address space.
+Plain memory pages are accessed through read_mem / write_mem, which point to the
+host memory backing the page. Pages with side effects leave the pointer NULL and
+are accessed through the read / write handlers instead. A page with neither is
+not accessible.
+dirty points to the page dirty word, untracked pages share a sink word. */
+typedef struct page_s
+{
+    const uint8_t *read_mem;
+    uint8_t *write_mem;
+    uint64_t *dirty;
+    mmu_read_access_t read;
+    mmu_write_access_t write;
+} page_t;
+
+typedef struct mmu_s
+{
+    page_t pages[MMU_PAGE_COUNT];
+    page_t *p_pages; /* Page table in use, pages or dma.pages while OAM DMA holds the bus. */
+
+    uint64_t dirty[MMU_DIRTY_PAGES];
+    uint64_t dirty_sink;
+
+    /* IO registers 0xFF00 - 0xFF7F, registers without handler are plain memory. */
+    io_handler_t io[MMU_IO_COUNT];
+    mmu_sync_t sync;
+    void *p_sync_context;
+
+    uint8_t *boot;
+    uint8_t *ram;
+    uint8_t *vram;
+    uint8_t *oam;
+    uint8_t *io_mem; /* IO registers and HRAM backing memory, 0xFF00 - 0xFFFF. */
+    cartridge_t *cartridge;     /* NULL while no cartridge is loaded. */
+    cartridge_t *cartridge_mem; /* Cartridge storage. */
+    cartridge_rumble_t rumble;
+    void *p_rumble_context;
+    int save_disabled; /* Cartridges are loaded without writing their save file. */
+
+    uint64_t clock; /* Elapsed clock cycles. */
+
+    /* OAM DMA, the transfer is copied at once either when it completes or
+    when OAM is read first. Until then the CPU can only access 0xFF00 - 0xFFFF. */
+    struct
+    {
+        int enabled;
+        int copied;
+        uint16_t source;
+        uint64_t end;
+        page_t *pages; /* MMU_PAGE_COUNT entries. */
+    } dma;
+
+    /* Watchpoints trap the pages they are on, other pages are accessed as usual.
+    pages holds the actual mapping of trapped pages, traps the kinds trapped. */
+    struct
+    {
+        mmu_watch_t points[MMU_WATCH_MAX];
+        int count;
+        mmu_fetch_t fetching; /* Set while the CPU fetches through a handler. */
+        uint8_t traps[MMU_PAGE_COUNT];
+        page_t *pages; /* MMU_PAGE_COUNT entries. */
+        mmu_watch_callback_t callback;
+        void *p_context;
+    } watch;
+
+#ifdef MMU_PROFILE
+    mmu_profile_t *profile;
+#endif
+
+} mmu_t;
+
+/* State pointing outside the arena, kept aside while a snapshot replaces it. */
+typedef struct mmu_host_s
+{
+    cartridge_t cartridge; /* Valid when has_cartridge is set. */
+    int has_cartridge;
+    mmu_sync_t sync;
+    void *p_sync_context;
+    cartridge_rumble_t rumble;
+    void *p_rumble_context;
+    mmu_watch_callback_t watch_callback;
+    void *p_watch_context;
+#ifdef MMU_PROFILE
+    mmu_profile_t *profile;
+#endif
+} mmu_host_t;
+
+#endif /*MMU_DEF_H_*/
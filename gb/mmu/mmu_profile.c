@@ -0,0 +1,112 @@
+#include "mmu_profile.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static int mmu_profile_dump_csv(mmu_profile_t *p_profile, FILE *file);
+static int mmu_profile_dump_bin(mmu_profile_t *p_profile, FILE *file);
+
+/*******************************************/
+
+mmu_profile_t *mmu_profile_allocate(void)
+{
+    return calloc(1, sizeof(mmu_profile_t));
+}
+
+void mmu_profile_reset(mmu_profile_t *p_profile)
+{
+    if (p_profile)
+    {
+        (void)memset(p_profile, 0, sizeof(mmu_profile_t));
+    }
+}
+
+int mmu_profile_dump(mmu_profile_t *p_profile, const char *path)
+{
+    if (!p_profile || !path)
+        return -1;
+
+    size_t length = strlen(path);
+    int csv = (length >= 4) && (0 == strcmp(path + length - 4, ".csv"));
+
+    FILE *file = fopen(path, csv ? "w" : "wb");
+    if (!file)
+    {
+        printf("Failed to open file: %s\n", path);
+        return -1;
+    }
+
+    int ret = csv ? mmu_profile_dump_csv(p_profile, file) : mmu_profile_dump_bin(p_profile, file);
+
+    if (0 != fclose(file))
+    {
+        ret = -1;
+    }
+
+    if (ret < 0)
+    {
+        printf("Failed to write MMU profile: %s\n", path);
+    }
+
+    return ret;
+}
+
+void mmu_profile_free(mmu_profile_t *p_profile)
+{
+    if (p_profile)
+    {
+        free(p_profile);
+    }
+}
+
+/*******************************************/
+
+/* Only addresses and banks accessed at least once are listed. */
+static int mmu_profile_dump_csv(mmu_profile_t *p_profile, FILE *file)
+{
+    int ret = 0;
+
+    if (fprintf(file, "address,reads,writes,fetches\n") < 0)
+        ret = -1;
+
+    for (int address = 0; (address < 0x10000) && (ret == 0); address++)
+    {
+        uint64_t reads = p_profile->addresses[MMU_PROFILE_READ][address];
+        uint64_t writes = p_profile->addresses[MMU_PROFILE_WRITE][address];
+        uint64_t fetches = p_profile->addresses[MMU_PROFILE_FETCH][address];
+
+        if ((reads | writes | fetches) && (fprintf(file, "0x%04x,%llu,%llu,%llu\n", address, (unsigned long long)reads, (unsigned long long)writes, (unsigned long long)fetches) < 0))
+            ret = -1;
+    }
+
+    if ((ret == 0) && (fprintf(file, "\nbank,reads,writes,fetches\n") < 0))
+        ret = -1;
+
+    for (int bank = 0; (bank < MMU_PROFILE_BANKS) && (ret == 0); bank++)
+    {
+        uint64_t reads = p_profile->banks[MMU_PROFILE_READ][bank];
+        uint64_t writes = p_profile->banks[MMU_PROFILE_WRITE][bank];
+        uint64_t fetches = p_profile->banks[MMU_PROFILE_FETCH][bank];
+
+        if ((reads | writes | fetches) && (fprintf(file, "%d,%llu,%llu,%llu\n", bank, (unsigned long long)reads, (unsigned long long)writes, (unsigned long long)fetches) < 0))
+            ret = -1;
+    }
+
+    return ret;
+}
+
+static int mmu_profile_dump_bin(mmu_profile_t *p_profile, FILE *file)
+{
+    uint32_t header[2] = {MMU_PROFILE_VERSION, MMU_PROFILE_BANKS};
+
+    if ((1 != fwrite("GBMP", 4, 1, file)) ||
+        (1 != fwrite(header, sizeof(header), 1, file)) ||
+        (1 != fwrite(p_profile->addresses, sizeof(p_profile->addresses), 1, file)) ||
+        (1 != fwrite(p_profile->banks, sizeof(p_profile->banks), 1, file)))
+    {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef MMU_PROFILE_H_
+#define MMU_PROFILE_H_
+
+#include <stdint.h>
+
+/* Memory access heat map, only compiled in with MMU_PROFILE defined.
+CPU reads, writes and instruction fetches are counted per address, ROM
+accesses are also counted per bank.
+
+Dumps are CSV when the path ends with ".csv", binary otherwise:
+-> char magic[4] "GBMP".
+-> uint32_t version, banks.
+-> uint64_t addresses[MMU_PROFILE_ACCESSES][0x10000].
+-> uint64_t banks[MMU_PROFILE_ACCESSES][banks].
+Host byte order. */
+
+#define MMU_PROFILE_VERSION (1)
+#define MMU_PROFILE_BANKS (512)
+
+typedef enum mmu_profile_access_e
+{
+    MMU_PROFILE_READ = 0,
+    MMU_PROFILE_WRITE,
+    MMU_PROFILE_FETCH,
+    MMU_PROFILE_ACCESSES
+} mmu_profile_access_t;
+
+typedef struct mmu_profile_s
+{
+    uint64_t addresses[MMU_PROFILE_ACCESSES][0x10000];
+    uint64_t banks[MMU_PROFILE_ACCESSES][MMU_PROFILE_BANKS];
+} mmu_profile_t;
+
+mmu_profile_t *mmu_profile_allocate(void);
+
+void mmu_profile_reset(mmu_profile_t *p_profile);
+
+int mmu_profile_dump(mmu_profile_t *p_profile, const char *path);
+
+void mmu_profile_free(mmu_profile_t *p_profile);
+
+static inline void mmu_profile_count(mmu_profile_t *p_profile, mmu_profile_access_t access, uint16_t address, int bank)
+{
+    p_profile->addresses[access][address]++;
+
+    if (address < 0x8000)
+    {
+        p_profile->banks[access][bank & (MMU_PROFILE_BANKS - 1)]++;
+    }
+}
+
+#endif /*MMU_PROFILE_H_*/
@@ -0,0 +1,264 @@
+#include "rom_cache.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define ROM_HEADER_SIZE (0x150)
+#define ROM_MIN_SIZE (0x8000)
+#define ROM_MAX_SIZE (0x800000)
+
+typedef struct rom_entry_s
+{
+    char *path;
+    uint8_t header_checksum;
+    uint16_t global_checksum;
+    off_t file_size;
+
+    uint8_t *rom;
+    size_t size;
+    int references;
+
+    struct rom_entry_s *next;
+} rom_entry_t;
+
+static pthread_mutex_t rom_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static rom_entry_t *rom_cache_entries = NULL;
+
+static int read_header(FILE *file, uint8_t *header);
+static size_t rom_size(const uint8_t *header, size_t file_size);
+static uint8_t *map_file(FILE *file, size_t file_size, size_t size);
+static void unmap_file(uint8_t *rom, size_t size);
+
+/*******************************************/
+
+const uint8_t *rom_cache_acquire(const char *path, size_t *p_size)
+{
+    if (!path)
+        return NULL;
+
+    FILE *file = fopen(path, "rb");
+
+    if (!file)
+    {
+        printf("Failed to open file: %s\n", path);
+        return NULL;
+    }
+
+    struct stat file_stat;
+    if (fstat(fileno(file), &file_stat) < 0)
+    {
+        printf("Failed to stat file: %s\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    if ((file_stat.st_size < ROM_HEADER_SIZE) || (file_stat.st_size > ROM_MAX_SIZE))
+    {
+        printf("Invalid file size: %ld\n", (long)file_stat.st_size);
+        fclose(file);
+        return NULL;
+    }
+
+    uint8_t header[ROM_HEADER_SIZE];
+    if (read_header(file, header) < 0)
+    {
+        printf("Failed to read ROM header: %s\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    uint8_t header_checksum = header[0x14D];
+    uint16_t global_checksum = (uint16_t)((header[0x14E] << 8) | header[0x14F]);
+
+    (void)pthread_mutex_lock(&rom_cache_lock);
+
+    rom_entry_t *p_entry = rom_cache_entries;
+    while (p_entry)
+    {
+        if ((p_entry->header_checksum == header_checksum) && (p_entry->global_checksum == global_checksum) &&
+            (p_entry->file_size == file_stat.st_size) && (0 == strcmp(p_entry->path, path)))
+        {
+            break;
+        }
+        p_entry = p_entry->next;
+    }
+
+    if (!p_entry)
+    {
+        size_t size = rom_size(header, file_stat.st_size);
+        uint8_t *rom = map_file(file, file_stat.st_size, size);
+
+        p_entry = rom ? calloc(1, sizeof(rom_entry_t)) : NULL;
+
+        if (p_entry)
+        {
+            p_entry->path = malloc(strlen(path) + 1);
+        }
+
+        if (!p_entry || !p_entry->path)
+        {
+            printf("Failed to map ROM: %s\n", path);
+
+            if (rom)
+            {
+                unmap_file(rom, size);
+            }
+            free(p_entry);
+            p_entry = NULL;
+        }
+        else
+        {
+            strcpy(p_entry->path, path);
+            p_entry->header_checksum = header_checksum;
+            p_entry->global_checksum = global_checksum;
+            p_entry->file_size = file_stat.st_size;
+            p_entry->rom = rom;
+            p_entry->size = size;
+
+            p_entry->next = rom_cache_entries;
+            rom_cache_entries = p_entry;
+        }
+    }
+
+    const uint8_t *rom = NULL;
+
+    if (p_entry)
+    {
+        p_entry->references += 1;
+
+        rom = p_entry->rom;
+        if (p_size)
+        {
+            *p_size = p_entry->size;
+        }
+    }
+
+    (void)pthread_mutex_unlock(&rom_cache_lock);
+
+    fclose(file);
+    return rom;
+}
+
+void rom_cache_release(const uint8_t *rom)
+{
+    if (!rom)
+        return;
+
+    (void)pthread_mutex_lock(&rom_cache_lock);
+
+    rom_entry_t **pp_entry = &rom_cache_entries;
+    while (*pp_entry)
+    {
+        rom_entry_t *p_entry = *pp_entry;
+
+        if (p_entry->rom == rom)
+        {
+            p_entry->references -= 1;
+
+            if (p_entry->references <= 0)
+            {
+                *pp_entry = p_entry->next;
+
+                unmap_file(p_entry->rom, p_entry->size);
+                free(p_entry->path);
+                free(p_entry);
+            }
+            break;
+        }
+
+        pp_entry = &p_entry->next;
+    }
+
+    (void)pthread_mutex_unlock(&rom_cache_lock);
+}
+
+/*******************************************/
+
+static int read_header(FILE *file, uint8_t *header)
+{
+    if (fseek(file, 0, SEEK_SET) < 0)
+        return -1;
+
+    if (1 != fread(header, ROM_HEADER_SIZE, 1, file))
+        return -1;
+
+    return 0;
+}
+
+/* Size declared in the header (32 KiB << n), never less than the file. */
+static size_t rom_size(const uint8_t *header, size_t file_size)
+{
+    size_t size = ROM_MIN_SIZE;
+
+    uint8_t code = header[0x148];
+    if (code <= 8)
+    {
+        size <<= code;
+    }
+
+    while (size < file_size)
+    {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+#ifndef _WIN32
+
+static uint8_t *map_file(FILE *file, size_t file_size, size_t size)
+{
+    /* Reserve the padded size as zero pages, then map the file over it. */
+    uint8_t *rom = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (MAP_FAILED == rom)
+        return NULL;
+
+    if (MAP_FAILED == mmap(rom, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fileno(file), 0))
+    {
+        (void)munmap(rom, size);
+        return NULL;
+    }
+
+    return rom;
+}
+
+static void unmap_file(uint8_t *rom, size_t size)
+{
+    (void)munmap(rom, size);
+}
+
+#else
+
+/* No mmap, fall back to a single private copy still shared through the cache. */
+static uint8_t *map_file(FILE *file, size_t file_size, size_t size)
+{
+    uint8_t *rom = calloc(size, sizeof(uint8_t));
+
+    if (!rom)
+        return NULL;
+
+    if ((fseek(file, 0, SEEK_SET) < 0) || (1 != fread(rom, file_size, 1, file)))
+    {
+        free(rom);
+        return NULL;
+    }
+
+    return rom;
+}
+
+static void unmap_file(uint8_t *rom, size_t size)
+{
+    free(rom);
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef ROM_CACHE_H_
+#define ROM_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Process wide ROM image cache.
+ROM files are mapped read only and shared by every cartridge loading the same
+file, identified by its path and header checksums. Images are reference counted
+and unmapped when the last cartridge releases them.
+
+Mappings are padded with zeros up to the ROM size declared in the header, so
+banks past the end of a truncated file stay readable. */
+
+const uint8_t *rom_cache_acquire(const char *path, size_t *p_size);
+void rom_cache_release(const uint8_t *rom);
+
+#endif /*ROM_CACHE_H_*/
@@ -0,0 +1,179 @@
+#include "rtc.h"
+
+#include <string.h>
+#include <time.h>
+
+#define RTC_CLOCK_HZ (4194304)
+
+#define RTC_DAY_SECONDS (24 * 60 * 60)
+#define RTC_MAX_DAYS (512)
+
+static void rtc_sync(rtc_t *p_rtc);
+static void rtc_get_regs(rtc_t *p_rtc, uint8_t *regs);
+static void rtc_set_regs(rtc_t *p_rtc, const uint8_t *regs);
+static void rtc_advance(rtc_t *p_rtc, uint64_t seconds);
+
+static void write_u32(uint8_t *buffer, uint32_t value);
+static uint32_t read_u32(const uint8_t *buffer);
+
+void rtc_init(rtc_t *p_rtc, const uint64_t *p_clock)
+{
+    (void)memset(p_rtc, 0, sizeof(rtc_t));
+
+    p_rtc->p_clock = p_clock;
+    p_rtc->clock = *p_clock;
+}
+
+void rtc_latch(rtc_t *p_rtc)
+{
+    rtc_sync(p_rtc);
+    rtc_get_regs(p_rtc, p_rtc->latched);
+}
+
+uint8_t rtc_read(rtc_t *p_rtc, uint8_t reg)
+{
+    return p_rtc->latched[reg - RTC_REG_S];
+}
+
+void rtc_write(rtc_t *p_rtc, uint8_t reg, uint8_t data)
+{
+    rtc_sync(p_rtc);
+
+    uint8_t regs[RTC_REG_COUNT];
+    rtc_get_regs(p_rtc, regs);
+
+    regs[reg - RTC_REG_S] = data;
+
+    if (RTC_REG_S == reg)
+    {
+        /* Writing seconds restarts the current second. */
+        p_rtc->clock = *p_rtc->p_clock;
+    }
+
+    rtc_set_regs(p_rtc, regs);
+}
+
+int rtc_load(rtc_t *p_rtc, const uint8_t *footer, size_t size)
+{
+    if (size < 44)
+    {
+        return -1;
+    }
+
+    uint8_t regs[RTC_REG_COUNT];
+    for (int i = 0; i < RTC_REG_COUNT; i++)
+    {
+        regs[i] = (uint8_t)read_u32(footer + (i * 4));
+        p_rtc->latched[i] = (uint8_t)read_u32(footer + 20 + (i * 4));
+    }
+
+    rtc_set_regs(p_rtc, regs);
+    p_rtc->clock = *p_rtc->p_clock;
+
+    /* The clock kept running while the emulator was off. */
+    uint64_t timestamp = read_u32(footer + 40);
+    if (size >= RTC_FOOTER_SIZE)
+    {
+        timestamp |= (uint64_t)read_u32(footer + 44) << 32;
+    }
+
+    uint64_t now = (uint64_t)time(NULL);
+    if (!p_rtc->halted && (now > timestamp))
+    {
+        rtc_advance(p_rtc, now - timestamp);
+    }
+
+    return 0;
+}
+
+void rtc_save(rtc_t *p_rtc, uint8_t *footer)
+{
+    rtc_sync(p_rtc);
+
+    uint8_t regs[RTC_REG_COUNT];
+    rtc_get_regs(p_rtc, regs);
+
+    for (int i = 0; i < RTC_REG_COUNT; i++)
+    {
+        write_u32(footer + (i * 4), regs[i]);
+        write_u32(footer + 20 + (i * 4), p_rtc->latched[i]);
+    }
+
+    uint64_t now = (uint64_t)time(NULL);
+    write_u32(footer + 40, (uint32_t)now);
+    write_u32(footer + 44, (uint32_t)(now >> 32));
+}
+
+/***************************************/
+
+/* Account for the cycles elapsed since the last synchronization. */
+static void rtc_sync(rtc_t *p_rtc)
+{
+    uint64_t now = *p_rtc->p_clock;
+
+    if (p_rtc->halted)
+    {
+        p_rtc->clock = now;
+        return;
+    }
+
+    uint64_t seconds = (now - p_rtc->clock) / RTC_CLOCK_HZ;
+
+    p_rtc->clock += seconds * RTC_CLOCK_HZ;
+    rtc_advance(p_rtc, seconds);
+}
+
+static void rtc_advance(rtc_t *p_rtc, uint64_t seconds)
+{
+    p_rtc->seconds += seconds;
+
+    if (p_rtc->seconds >= (uint64_t)RTC_MAX_DAYS * RTC_DAY_SECONDS)
+    {
+        p_rtc->seconds %= (uint64_t)RTC_MAX_DAYS * RTC_DAY_SECONDS;
+        p_rtc->carry = 1;
+    }
+}
+
+static void rtc_get_regs(rtc_t *p_rtc, uint8_t *regs)
+{
+    uint64_t days = p_rtc->seconds / RTC_DAY_SECONDS;
+    uint64_t time = p_rtc->seconds % RTC_DAY_SECONDS;
+
+    regs[0] = (uint8_t)(time % 60);
+    regs[1] = (uint8_t)((time / 60) % 60);
+    regs[2] = (uint8_t)(time / 3600);
+    regs[3] = (uint8_t)days;
+    regs[4] = (uint8_t)((days >> 8) & 0x01);
+
+    if (p_rtc->halted)
+    {
+        regs[4] |= 0x40;
+    }
+
+    if (p_rtc->carry)
+    {
+        regs[4] |= 0x80;
+    }
+}
+
+static void rtc_set_regs(rtc_t *p_rtc, const uint8_t *regs)
+{
+    uint64_t days = ((uint64_t)(regs[4] & 0x01) << 8) | regs[3];
+
+    p_rtc->seconds = (days * RTC_DAY_SECONDS) + ((uint64_t)(regs[2] & 0x1F) * 3600) + ((uint64_t)(regs[1] & 0x3F) * 60) + (regs[0] & 0x3F);
+    p_rtc->halted = (0 != (regs[4] & 0x40));
+    p_rtc->carry = (0 != (regs[4] & 0x80));
+}
+
+static void write_u32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t read_u32(const uint8_t *buffer)
+{
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
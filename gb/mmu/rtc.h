@@ -0,0 +1,54 @@
+#ifndef RTC_H_
+#define RTC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* MBC3 Real Time Clock
+0x08 RTC S  Seconds.
+0x09 RTC M  Minutes.
+0x0A RTC H  Hours.
+0x0B RTC DL Day counter, lower 8 bits.
+0x0C RTC DH Day counter, upper bit, halt and carry flags.
+-> DH0 Day counter bit 8.
+-> DH6 Halt.
+-> DH7 Day counter carry.
+
+The clock is not ticked, its time is derived from the emulated clock cycles
+elapsed since the last time it was synchronized. */
+
+#define RTC_REG_S (0x08)
+#define RTC_REG_M (0x09)
+#define RTC_REG_H (0x0A)
+#define RTC_REG_DL (0x0B)
+#define RTC_REG_DH (0x0C)
+
+#define RTC_REG_COUNT (5)
+
+#define RTC_FOOTER_SIZE (48)
+
+typedef struct rtc_s
+{
+    const uint64_t *p_clock; /* Emulated clock cycles. */
+    uint64_t clock;          /* Cycles at which seconds was last synchronized. */
+
+    uint64_t seconds; /* Time counter, up to 512 days. */
+    int halted;
+    int carry;
+
+    uint8_t latched[RTC_REG_COUNT];
+} rtc_t;
+
+void rtc_init(rtc_t *p_rtc, const uint64_t *p_clock);
+
+void rtc_latch(rtc_t *p_rtc);
+
+uint8_t rtc_read(rtc_t *p_rtc, uint8_t reg);
+void rtc_write(rtc_t *p_rtc, uint8_t reg, uint8_t data);
+
+/* Save file footer, compatible with the common 48 bytes layout.
+Older 44 bytes footers (32 bits timestamp) are accepted on load. */
+int rtc_load(rtc_t *p_rtc, const uint8_t *footer, size_t size);
+void rtc_save(rtc_t *p_rtc, uint8_t *footer);
+
+#endif /*RTC_H_*/
@@ -0,0 +1,209 @@
+#include "save_file.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SAVE_SYNC_PERIOD_S (1)
+
+static int save_file_map(save_file_t *p_save, const char *path);
+static void save_file_unmap(save_file_t *p_save);
+static void save_file_sync(save_file_t *p_save);
+static void *save_file_run(void *p_context);
+
+/*******************************************/
+
+save_file_t *save_file_open(const char *path, size_t size)
+{
+    if (!path || !size)
+        return NULL;
+
+    save_file_t *p_save = calloc(1, sizeof(save_file_t));
+
+    if (!p_save)
+        return NULL;
+
+    p_save->size = size;
+    atomic_init(&p_save->dirty, 0);
+
+    if (save_file_map(p_save, path) < 0)
+    {
+        printf("Failed to map save file: %s\n", path);
+        free(p_save);
+        return NULL;
+    }
+
+    (void)pthread_mutex_init(&p_save->lock, NULL);
+    (void)pthread_cond_init(&p_save->cond, NULL);
+
+    p_save->running = 1;
+    if (0 != pthread_create(&p_save->thread, NULL, save_file_run, p_save))
+    {
+        /* Still usable, only synced when closed. */
+        printf("Failed to start save file thread: %s\n", path);
+        p_save->running = 0;
+    }
+
+    return p_save;
+}
+
+void save_file_close(save_file_t *p_save)
+{
+    if (!p_save)
+        return;
+
+    if (p_save->running)
+    {
+        (void)pthread_mutex_lock(&p_save->lock);
+        p_save->running = 0;
+        (void)pthread_cond_signal(&p_save->cond);
+        (void)pthread_mutex_unlock(&p_save->lock);
+
+        (void)pthread_join(p_save->thread, NULL);
+    }
+
+    save_file_sync(p_save);
+    save_file_unmap(p_save);
+
+    (void)pthread_cond_destroy(&p_save->cond);
+    (void)pthread_mutex_destroy(&p_save->lock);
+
+    free(p_save);
+}
+
+/*******************************************/
+
+/* Periodically flush dirty saves, off the emulation thread. */
+static void *save_file_run(void *p_context)
+{
+    save_file_t *p_save = p_context;
+
+    (void)pthread_mutex_lock(&p_save->lock);
+
+    while (p_save->running)
+    {
+        struct timespec deadline;
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += SAVE_SYNC_PERIOD_S;
+
+        int ret = 0;
+        while (p_save->running && (ETIMEDOUT != ret))
+        {
+            ret = pthread_cond_timedwait(&p_save->cond, &p_save->lock, &deadline);
+        }
+
+        if (p_save->running)
+        {
+            (void)pthread_mutex_unlock(&p_save->lock);
+            save_file_sync(p_save);
+            (void)pthread_mutex_lock(&p_save->lock);
+        }
+    }
+
+    (void)pthread_mutex_unlock(&p_save->lock);
+    return NULL;
+}
+
+#ifndef _WIN32
+
+static int save_file_map(save_file_t *p_save, const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+        return -1;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    p_save->loaded_size = file_stat.st_size;
+
+    /* Grow with zeros, never truncate an existing (larger) save. */
+    if (((size_t)file_stat.st_size < p_save->size) && (ftruncate(fd, p_save->size) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    uint8_t *mem = mmap(NULL, p_save->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    /* The mapping keeps the file referenced. */
+    close(fd);
+
+    if (MAP_FAILED == mem)
+        return -1;
+
+    p_save->mem = mem;
+    return 0;
+}
+
+static void save_file_unmap(save_file_t *p_save)
+{
+    (void)munmap(p_save->mem, p_save->size);
+    p_save->mem = NULL;
+}
+
+static void save_file_sync(save_file_t *p_save)
+{
+    if (atomic_exchange(&p_save->dirty, 0))
+    {
+        (void)msync(p_save->mem, p_save->size, MS_SYNC);
+    }
+}
+
+#else
+
+static int save_file_map(save_file_t *p_save, const char *path)
+{
+    p_save->file = fopen(path, "r+b");
+    if (!p_save->file)
+    {
+        p_save->file = fopen(path, "w+b");
+    }
+
+    p_save->mem = calloc(p_save->size, sizeof(uint8_t));
+
+    if (!p_save->file || !p_save->mem)
+    {
+        if (p_save->file)
+        {
+            fclose(p_save->file);
+        }
+        free(p_save->mem);
+        return -1;
+    }
+
+    p_save->loaded_size = fread(p_save->mem, 1, p_save->size, p_save->file);
+    return 0;
+}
+
+static void save_file_unmap(save_file_t *p_save)
+{
+    fclose(p_save->file);
+    free(p_save->mem);
+    p_save->mem = NULL;
+}
+
+static void save_file_sync(save_file_t *p_save)
+{
+    if (atomic_exchange(&p_save->dirty, 0))
+    {
+        (void)fseek(p_save->file, 0, SEEK_SET);
+        (void)fwrite(p_save->mem, p_save->size, 1, p_save->file);
+        (void)fflush(p_save->file);
+    }
+}
+
+#endif
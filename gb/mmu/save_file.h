@@ -0,0 +1,43 @@
+#ifndef SAVE_FILE_H_
+#define SAVE_FILE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdio.h>
+
+/* Battery backed save file.
+The file is mapped shared into memory, so writes reach the file without any
+copy. Writers flag the file dirty, a background thread msyncs dirty files
+periodically and the file is synced once more when closed. */
+
+typedef struct save_file_s
+{
+    uint8_t *mem;
+    size_t size;
+    size_t loaded_size; /* Size of the file before it was opened, 0 if new. */
+
+    atomic_int dirty;
+
+#ifdef _WIN32
+    FILE *file; /* No mmap, the buffer is written back on sync. */
+#endif
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int running;
+} save_file_t;
+
+/* Open (or create) path, grown with zeros up to size. */
+save_file_t *save_file_open(const char *path, size_t size);
+
+static inline void save_file_touch(save_file_t *p_save)
+{
+    atomic_store_explicit(&p_save->dirty, 1, memory_order_relaxed);
+}
+
+void save_file_close(save_file_t *p_save);
+
+#endif /*SAVE_FILE_H_*/
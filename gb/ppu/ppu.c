@@ -6,20 +6,28 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <limits.h>
 
 static void ppu_load_oam_entries(ppu_t *p_ppu);
 
-ppu_t *ppu_allocate(mmu_t *p_mmu, screen_t *p_screen)
+size_t ppu_arena_size(void)
+{
+    return ARENA_SIZE(sizeof(ppu_t));
+}
+
+ppu_t *ppu_allocate(arena_t *p_arena, mmu_t *p_mmu, screen_t *p_screen)
 {
     if (!p_mmu || !p_screen)
         return NULL;
 
-    ppu_t *p_ppu = calloc(1, sizeof(ppu_t));
+    ppu_t *p_ppu = arena_alloc(p_arena, sizeof(ppu_t));
 
     if (p_ppu)
     {
         p_ppu->mmu = p_mmu;
         p_ppu->screen = p_screen;
+
+        ppu_regs_register(p_ppu);
     }
 
     return p_ppu;
@@ -34,8 +42,6 @@ int ppu_execute(ppu_t *p_ppu)
 
     p_ppu->status.cycles += 1;
 
-    ppu_reg_read_lcdc(p_ppu);
-
     if (!p_ppu->status.enabled)
         return 1;
 
@@ -46,11 +52,6 @@ int ppu_execute(ppu_t *p_ppu)
 
         if (p_ppu->status.cycles >= 20 * 40)
         {
-            ppu_reg_read_sc(p_ppu);
-            ppu_reg_read_lyc(p_ppu);
-            ppu_reg_read_bgp_obp(p_ppu);
-            ppu_reg_read_w(p_ppu);
-
             ppu_load_oam_entries(p_ppu);
 
             p_ppu->status.cycles = 0;
@@ -127,11 +128,67 @@ int ppu_execute(ppu_t *p_ppu)
     return 1;
 }
 
-void ppu_free(ppu_t *p_ppu)
+int ppu_quiet_cycles(ppu_t *p_ppu)
 {
-    if (p_ppu)
+    int end;
+
+    if (!p_ppu->status.enabled)
+        return INT_MAX;
+
+    /* Mode ends on the cycle reaching end. */
+    switch (p_ppu->status.mode)
+    {
+    case PPU_MODE_OAM_SEARCH:
+        end = 20 * 40;
+        break;
+    case PPU_MODE_H_BLANK:
+        end = (43 + 51) * 4;
+        break;
+    case PPU_MODE_V_BLANK:
+        end = 114 * 4;
+        break;
+    default:
+        /* Pixel transfer reads memory on every cycle. */
+        return 0;
+    }
+
+    int quiet = end - 1 - p_ppu->status.cycles;
+    return (quiet > 0) ? quiet : 0;
+}
+
+int ppu_irq_quiet_cycles(ppu_t *p_ppu)
+{
+    if (p_ppu->status.enabled && (p_ppu->status.mode == PPU_MODE_PIXEL_TRANSFER))
     {
-        free(p_ppu);
+        /* At most one pixel per cycle, the line cannot end before pixel 160. */
+        int quiet = 160 - 1 - p_ppu->status.pixel_index;
+        return (quiet > 0) ? quiet : 0;
+    }
+
+    return ppu_quiet_cycles(p_ppu);
+}
+
+void ppu_run(ppu_t *p_ppu, int cycles)
+{
+    while (cycles > 0)
+    {
+        int quiet = ppu_quiet_cycles(p_ppu);
+
+        if (quiet)
+        {
+            if (quiet > cycles)
+            {
+                quiet = cycles;
+            }
+
+            p_ppu->status.cycles += quiet;
+            cycles -= quiet;
+        }
+        else
+        {
+            (void)ppu_execute(p_ppu);
+            cycles -= 1;
+        }
     }
 }
 
@@ -141,28 +198,23 @@ static void ppu_load_oam_entries(ppu_t *p_ppu)
 
     for (int s = 0; s < 40; s++)
     {
-        uint8_t y = 0;
-        (void)mmu_read_u8(p_ppu->mmu, 0xFE00 + (4 * s) + 0, &y);
+        uint8_t y = mmu_oam_read(p_ppu->mmu, 0xFE00 + (4 * s) + 0);
         p_ppu->sprites.entries[s].y = y;
 
-        uint8_t x = 0;
-        (void)mmu_read_u8(p_ppu->mmu, 0xFE00 + (4 * s) + 1, &x);
+        uint8_t x = mmu_oam_read(p_ppu->mmu, 0xFE00 + (4 * s) + 1);
         p_ppu->sprites.entries[s].x = x;
 
-        uint8_t tile_index = 0;
-        (void)mmu_read_u8(p_ppu->mmu, 0xFE00 + (4 * s) + 2, &tile_index);
+        uint8_t tile_index = mmu_oam_read(p_ppu->mmu, 0xFE00 + (4 * s) + 2);
         p_ppu->sprites.entries[s].tile_index = tile_index;
 
         uint16_t tile_address = p_ppu->sprites.tiles_address + (tile_index * 16);
         for (int i = 0; i < 16; i++)
         {
-            uint8_t data = 0;
-            (void)mmu_read_u8(p_ppu->mmu, tile_address + i, &data);
+            uint8_t data = mmu_vram_read(p_ppu->mmu, tile_address + i);
             p_ppu->sprites.entries[s].tile.data[i] = data;
         }
 
-        uint8_t flags = 0;
-        (void)mmu_read_u8(p_ppu->mmu, 0xFE00 + (4 * s) + 3, &flags);
+        uint8_t flags = mmu_oam_read(p_ppu->mmu, 0xFE00 + (4 * s) + 3);
         p_ppu->sprites.entries[s].flags.priority = (flags >> 7) & 0x01;
         p_ppu->sprites.entries[s].flags.flip_y = (flags >> 6) & 0x01;
         p_ppu->sprites.entries[s].flags.flip_x = (flags >> 5) & 0x01;
@@ -3,6 +3,7 @@
 
 #include "../mmu/mmu.h"
 #include "../screen.h"
+#include "../arena.h"
 
 typedef struct ppu_s ppu_t;
 
@@ -72,10 +73,21 @@ Fetcher
 
 */
 
-ppu_t *ppu_allocate(mmu_t *p_mmu, screen_t *p_screen);
+size_t ppu_arena_size(void);
+
+ppu_t *ppu_allocate(arena_t *p_arena, mmu_t *p_mmu, screen_t *p_screen);
 
 int ppu_execute(ppu_t *p_ppu);
 
-void ppu_free(ppu_t *p_ppu);
+/* Cycles the PPU can run before the CPU could tell, that is before registers,
+IRQ flags change or VRAM / OAM are read. */
+int ppu_quiet_cycles(ppu_t *p_ppu);
+
+/* Cycles before registers or IRQ flags change, VRAM / OAM reads aside. Enough
+while the CPU is halted and cannot write memory. */
+int ppu_irq_quiet_cycles(ppu_t *p_ppu);
+
+/* Same as cycles calls to ppu_execute. */
+void ppu_run(ppu_t *p_ppu, int cycles);
 
 #endif /*PPU_H_*/
\ No newline at end of file
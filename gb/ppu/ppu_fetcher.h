@@ -38,8 +38,7 @@ static inline void fetch_background(ppu_t *p_ppu)
         uint16_t line = (uint16_t)(p_ppu->fetcher.background_y / 8);
         uint16_t addr = p_ppu->background.map_address + (line * 32) + p_ppu->fetcher.background_x;
 
-        uint8_t tile_index = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_index);
+        uint8_t tile_index = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.index = tile_index;
         p_ppu->fetcher.state = FETCHER_GET_DATA_0;
@@ -53,8 +52,7 @@ static inline void fetch_background(ppu_t *p_ppu)
         addr += (uint16_t)p_ppu->fetcher.tile.index * (uint16_t)16;
         addr += (p_ppu->fetcher.background_y % 8) * 2;
 
-        uint8_t tile_data0 = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_data0);
+        uint8_t tile_data0 = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.data[0] = tile_data0;
         p_ppu->fetcher.state = FETCHER_GET_DATA_1;
@@ -69,8 +67,7 @@ static inline void fetch_background(ppu_t *p_ppu)
         addr += (p_ppu->fetcher.background_y % 8) * 2;
         addr += 1;
 
-        uint8_t tile_data1 = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_data1);
+        uint8_t tile_data1 = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.data[1] = tile_data1;
         p_ppu->fetcher.state = FETCHER_WAIT;
@@ -121,8 +118,7 @@ static inline void fetch_window(ppu_t *p_ppu)
         uint16_t line = (uint16_t)(p_ppu->fetcher.window_y / 8);
         uint16_t addr = p_ppu->window.map_address + (line * 32) + p_ppu->fetcher.window_x;
 
-        uint8_t tile_index = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_index);
+        uint8_t tile_index = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.index = tile_index;
         p_ppu->fetcher.state = FETCHER_GET_DATA_0;
@@ -136,8 +132,7 @@ static inline void fetch_window(ppu_t *p_ppu)
         addr += (uint16_t)p_ppu->fetcher.tile.index * (uint16_t)16;
         addr += (p_ppu->fetcher.window_y % 8) * 2;
 
-        uint8_t tile_data0 = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_data0);
+        uint8_t tile_data0 = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.data[0] = tile_data0;
         p_ppu->fetcher.state = FETCHER_GET_DATA_1;
@@ -152,8 +147,7 @@ static inline void fetch_window(ppu_t *p_ppu)
         addr += (p_ppu->fetcher.window_y % 8) * 2;
         addr += 1;
 
-        uint8_t tile_data1 = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_data1);
+        uint8_t tile_data1 = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.data[1] = tile_data1;
         p_ppu->fetcher.state = FETCHER_WAIT;
@@ -225,8 +219,7 @@ static inline void fetch_sprite(ppu_t *p_ppu)
         addr += (uint16_t)p_ppu->fetcher.tile.index * (uint16_t)16;
         addr += line * 2;
 
-        uint8_t tile_data0 = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_data0);
+        uint8_t tile_data0 = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.data[0] = tile_data0;
         p_ppu->fetcher.state = FETCHER_GET_DATA_1;
@@ -248,8 +241,7 @@ static inline void fetch_sprite(ppu_t *p_ppu)
         addr += line * 2;
         addr += 1;
 
-        uint8_t tile_data1 = 0;
-        (void)mmu_read_u8(p_ppu->mmu, addr, &tile_data1);
+        uint8_t tile_data1 = mmu_vram_read(p_ppu->mmu, addr);
 
         p_ppu->fetcher.tile.data[1] = tile_data1;
         p_ppu->fetcher.state = FETCHER_WAIT;
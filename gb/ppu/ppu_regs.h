@@ -26,76 +26,137 @@ static inline uint8_t get_color(uint8_t palette_color)
     return PPU_PALETTE_COLORS[palette_color];
 }
 
-/* Read accesses. */
+/* Register write hooks, registers are decoded when the CPU writes them. */
 
-static inline void ppu_reg_read_lcdc(ppu_t *p_ppu)
+static inline int ppu_io_write_lcdc(void *p_context, uint16_t address, uint8_t data)
 {
-    uint8_t lcdc;
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_LCDC, &lcdc);
+    ppu_t *p_ppu = p_context;
 
-    p_ppu->status.enabled = (0 != ((lcdc >> 7) & 0x01));
-    p_ppu->window.map_address = ((lcdc >> 6) & 0x01) ? 0x9C00 : 0x9800;
-    p_ppu->window.enabled = (0 != ((lcdc >> 5) & 0x01));
-    p_ppu->background.tiles_address = ((lcdc >> 4) & 0x01) ? 0x8000 : 0x8800;
+    p_ppu->status.enabled = (0 != ((data >> 7) & 0x01));
+    p_ppu->window.map_address = ((data >> 6) & 0x01) ? 0x9C00 : 0x9800;
+    p_ppu->window.enabled = (0 != ((data >> 5) & 0x01));
+    p_ppu->background.tiles_address = ((data >> 4) & 0x01) ? 0x8000 : 0x8800;
     p_ppu->sprites.tiles_address = 0x8000;
-    p_ppu->background.map_address = ((lcdc >> 3) & 0x01) ? 0x9C00 : 0x9800;
-    p_ppu->sprites.enabled = (0 != ((lcdc >> 2) & 0x01));
+    p_ppu->background.map_address = ((data >> 3) & 0x01) ? 0x9C00 : 0x9800;
+    p_ppu->sprites.enabled = (0 != ((data >> 2) & 0x01));
     //TODO
     // 1 obj size
-    p_ppu->background.enabled = (0 != ((lcdc >> 0) & 0x01));
+    p_ppu->background.enabled = (0 != ((data >> 0) & 0x01));
+
+    mmu_io_set(p_ppu->mmu, address, data);
+    return 0;
+}
+
+static inline int ppu_io_write_stat(void *p_context, uint16_t address, uint8_t data)
+{
+    ppu_t *p_ppu = p_context;
+
+    /* Coincidence flag and mode are read only. */
+    uint8_t stat = mmu_io_get(p_ppu->mmu, address);
+    stat = (data & 0x78) | (stat & 0x07);
+
+    mmu_io_set(p_ppu->mmu, address, stat);
+    return 0;
+}
+
+static inline int ppu_io_write_sc(void *p_context, uint16_t address, uint8_t data)
+{
+    ppu_t *p_ppu = p_context;
+
+    if (PPU_REG_SCY == address)
+    {
+        p_ppu->viewport.y = data;
+    }
+    else
+    {
+        p_ppu->viewport.x = data;
+    }
+
+    mmu_io_set(p_ppu->mmu, address, data);
+    return 0;
 }
 
-static inline void ppu_reg_read_sc(ppu_t *p_ppu)
+static inline int ppu_io_write_ly(void *p_context, uint16_t address, uint8_t data)
 {
-    uint8_t scy, scx;
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_SCY, &scy);
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_SCX, &scx);
+    (void)p_context;
+    (void)address;
+    (void)data;
 
-    p_ppu->viewport.y = scy;
-    p_ppu->viewport.x = scx;
+    /* Read only. */
+    return 0;
 }
 
-static inline void ppu_reg_read_lyc(ppu_t *p_ppu)
+static inline int ppu_io_write_lyc(void *p_context, uint16_t address, uint8_t data)
 {
-    uint8_t lyc;
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_LYC, &lyc);
+    ppu_t *p_ppu = p_context;
 
-    p_ppu->status.line_y_compare = lyc;
+    p_ppu->status.line_y_compare = data;
+
+    mmu_io_set(p_ppu->mmu, address, data);
+    return 0;
 }
 
-static inline void ppu_reg_read_bgp_obp(ppu_t *p_ppu)
+static inline int ppu_io_write_palette(void *p_context, uint16_t address, uint8_t data)
 {
-    uint8_t bgp;
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_BGP, &bgp);
+    ppu_t *p_ppu = p_context;
+
+    palette_t *p_palette = &p_ppu->bg_palette;
 
-    uint8_t obp[2];
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_OBP0, &obp[0]);
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_OBP1, &obp[1]);
+    if (PPU_REG_OBP0 == address)
+    {
+        p_palette = &p_ppu->obj_palettes[0];
+    }
+    else if (PPU_REG_OBP1 == address)
+    {
+        p_palette = &p_ppu->obj_palettes[1];
+    }
 
     for (int i = 0; i < 4; i++)
     {
-        p_ppu->bg_palette.color[i] = get_color((bgp >> (i * 2)) & 0x03);
-        p_ppu->obj_palettes[0].color[i] = get_color((obp[0] >> (i * 2)) & 0x03);
-        p_ppu->obj_palettes[1].color[i] = get_color((obp[1] >> (i * 2)) & 0x03);
+        p_palette->color[i] = get_color((data >> (i * 2)) & 0x03);
     }
+
+    mmu_io_set(p_ppu->mmu, address, data);
+    return 0;
 }
 
-static inline void ppu_reg_read_w(ppu_t *p_ppu)
+static inline int ppu_io_write_w(void *p_context, uint16_t address, uint8_t data)
 {
-    uint8_t wy, wx;
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_WY, &wx);
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_WX, &wy);
+    ppu_t *p_ppu = p_context;
 
-    p_ppu->window.y = wy;
-    p_ppu->window.x = wx;
+    if (PPU_REG_WY == address)
+    {
+        p_ppu->window.y = data;
+    }
+    else
+    {
+        p_ppu->window.x = data;
+    }
+
+    mmu_io_set(p_ppu->mmu, address, data);
+    return 0;
+}
+
+static inline void ppu_regs_register(ppu_t *p_ppu)
+{
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_LCDC, NULL, ppu_io_write_lcdc, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_STAT, NULL, ppu_io_write_stat, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_SCY, NULL, ppu_io_write_sc, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_SCX, NULL, ppu_io_write_sc, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_LY, NULL, ppu_io_write_ly, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_LYC, NULL, ppu_io_write_lyc, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_BGP, NULL, ppu_io_write_palette, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_OBP0, NULL, ppu_io_write_palette, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_OBP1, NULL, ppu_io_write_palette, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_WY, NULL, ppu_io_write_w, p_ppu);
+    (void)mmu_register_io(p_ppu->mmu, PPU_REG_WX, NULL, ppu_io_write_w, p_ppu);
 }
 
 /* Write accesses. */
 
 static inline void ppu_reg_write_stat(ppu_t *p_ppu)
 {
-    uint8_t stat;
-    (void)mmu_read_u8(p_ppu->mmu, PPU_REG_STAT, &stat);
+    uint8_t stat = mmu_io_get(p_ppu->mmu, PPU_REG_STAT);
 
     int coincidence_irq = (0 != ((stat >> 6) & 0x01));
     int oam_irq = (0 != ((stat >> 5) & 0x01));
@@ -115,11 +176,10 @@ static inline void ppu_reg_write_stat(ppu_t *p_ppu)
     /* PPU mode */
     stat |= p_ppu->status.mode & 0x03;
 
-    (void)mmu_write_u8(p_ppu->mmu, PPU_REG_STAT, stat);
+    mmu_io_set(p_ppu->mmu, PPU_REG_STAT, stat);
 
     //TODO Cleaner way
-    uint8_t irq_flags;
-    (void)mmu_read_u8(p_ppu->mmu, 0xFF0F, &irq_flags);
+    uint8_t irq_flags = mmu_io_get(p_ppu->mmu, 0xFF0F);
 
     int stat_flag = (0 != ((irq_flags >> 1) & 0x01));
 
@@ -155,7 +215,7 @@ static inline void ppu_reg_write_stat(ppu_t *p_ppu)
         irq_flags |= 0x01;
     }
 
-    (void)mmu_write_u8(p_ppu->mmu, 0xFF0F, irq_flags);
+    mmu_io_set(p_ppu->mmu, 0xFF0F, irq_flags);
 }
 
 static inline void ppu_reg_write_LY(ppu_t *p_ppu)
@@ -163,7 +223,7 @@ static inline void ppu_reg_write_LY(ppu_t *p_ppu)
     uint8_t ly;
     ly = p_ppu->status.line_y;
 
-    (void)mmu_write_u8(p_ppu->mmu, PPU_REG_LY, ly);
+    mmu_io_set(p_ppu->mmu, PPU_REG_LY, ly);
 }
 
 #endif /*PPU_REGS_H_*/
\ No newline at end of file
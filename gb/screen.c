@@ -2,36 +2,30 @@
 
 #include "stdlib.h"
 
-screen_t *screen_allocate(void)
+#define SCREEN_WIDTH (160)
+#define SCREEN_HEIGHT (144)
+#define SCREEN_BUFFER_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT * 3)
+
+size_t screen_arena_size(void)
+{
+    return ARENA_SIZE(sizeof(screen_t)) + ARENA_SIZE(SCREEN_BUFFER_SIZE);
+}
+
+screen_t *screen_allocate(arena_t *p_arena)
 {
-    screen_t *p_screen = malloc(sizeof(screen_t));
+    screen_t *p_screen = arena_alloc(p_arena, sizeof(screen_t));
 
     if (p_screen)
     {
-        p_screen->width = 160;
-        p_screen->height = 144;
-        p_screen->buffer = malloc(p_screen->width * p_screen->height * 3);
+        p_screen->width = SCREEN_WIDTH;
+        p_screen->height = SCREEN_HEIGHT;
+        p_screen->buffer = arena_alloc_bulk(p_arena, SCREEN_BUFFER_SIZE);
 
         if (!p_screen->buffer)
         {
-            screen_free(p_screen);
             p_screen = NULL;
         }
     }
 
     return p_screen;
 }
-
-void screen_free(screen_t *p_screen)
-{
-    if (p_screen)
-    {
-        if (p_screen->buffer)
-        {
-            free(p_screen->buffer);
-            p_screen->buffer = NULL;
-        }
-
-        free(p_screen);
-    }
-}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef SCREEN_H_
 #define SCREEN_H_
 
+#include "arena.h"
+
 typedef struct screen_s
 {
     int width;
@@ -8,8 +10,8 @@ typedef struct screen_s
     unsigned char *buffer;
 } screen_t;
 
-screen_t *screen_allocate(void);
+size_t screen_arena_size(void);
 
-void screen_free(screen_t *p_screen);
+screen_t *screen_allocate(arena_t *p_arena);
 
 #endif /*SCREEN_H_*/
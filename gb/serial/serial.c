@@ -0,0 +1,56 @@
+#include "serial.h"
+
+#include <stdlib.h>
+
+#define SERIAL_REG_SB (0xFF01)
+#define SERIAL_REG_SC (0xFF02)
+#define SERIAL_REG_IF (0xFF0F)
+
+struct serial_s
+{
+    mmu_t *mmu;
+};
+
+static int serial_write_sc(void *p_context, uint16_t address, uint8_t data);
+
+size_t serial_arena_size(void)
+{
+    return ARENA_SIZE(sizeof(serial_t));
+}
+
+serial_t *serial_allocate(arena_t *p_arena, mmu_t *p_mmu)
+{
+    if (!p_mmu)
+        return NULL;
+
+    serial_t *p_serial = arena_alloc(p_arena, sizeof(serial_t));
+
+    if (p_serial)
+    {
+        p_serial->mmu = p_mmu;
+
+        (void)mmu_register_io(p_mmu, SERIAL_REG_SC, NULL, serial_write_sc, p_serial);
+    }
+
+    return p_serial;
+}
+
+/* Private function definitions */
+
+static int serial_write_sc(void *p_context, uint16_t address, uint8_t data)
+{
+    serial_t *p_serial = p_context;
+
+    if ((data & 0x81) == 0x81)
+    {
+        /* No link partner, internal clock transfers complete at once
+        and shift in 0xFF. */
+        mmu_io_set(p_serial->mmu, SERIAL_REG_SB, 0xFF);
+        mmu_io_set(p_serial->mmu, SERIAL_REG_IF, mmu_io_get(p_serial->mmu, SERIAL_REG_IF) | 0x08);
+
+        data &= 0x7F;
+    }
+
+    mmu_io_set(p_serial->mmu, address, data | 0x7E);
+    return 0;
+}
@@ -1,6 +1,11 @@
 #ifndef SERIAL_H_
 #define SERIAL_H_
 
+#include "../mmu/mmu.h"
+#include "../arena.h"
+
+typedef struct serial_s serial_t;
+
 /* Serial Data Transfer
 0xFF01 SB Serial Transfer Data.
 0xFF02 SC Serial TRansfer Control.
@@ -8,4 +13,8 @@
 -> SC0 Clock Source.
 */
 
+size_t serial_arena_size(void);
+
+serial_t *serial_allocate(arena_t *p_arena, mmu_t *p_mmu);
+
 #endif /*SERIAL_H_*/
\ No newline at end of file
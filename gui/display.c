@@ -257,6 +257,8 @@ static void display_dbg_cpu(display_t *p_display, gb_t *p_gb)
     char buffer[50];
     char str[40];
 
+    cpu_sync_flags(p_gb->cpu);
+
     snprintf(str, 40, "AF:0x%04x", p_gb->cpu->reg_AF);
     display_text(p_display, 0 * 120, 20 * (4 + 0), str);
     snprintf(str, 40, "BC:0x%04x", p_gb->cpu->reg_BC);
@@ -271,6 +273,8 @@ static void display_dbg_cpu(display_t *p_display, gb_t *p_gb)
     display_text(p_display, 0 * 120, 20 * (4 + 5), str);
     snprintf(str, 40, "IME:%d", p_gb->cpu->irq_master_enable);
     display_text(p_display, 0 * 120, 20 * (4 + 6), str);
+    snprintf(str, 40, "Skip:%llu", (unsigned long long)p_gb->cpu->busy_wait_cycles);
+    display_text(p_display, 0 * 120, 20 * (4 + 7), str);
 }
 
 /*
@@ -3,8 +3,59 @@
 
 #include "SDL2/SDL.h"
 
+#include <fcntl.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define TRACE_PATH "cpu_trace.bin"
+
+/* Instance traced with --trace, its trace is dumped when the emulator crashes.
+The dump file is opened beforehand, the handler only uses async signal safe
+calls: the heap may be what is broken. */
+static gb_t *p_traced_gb = NULL;
+static int trace_fd = -1;
+
+static void main_crash(int sig)
+{
+	if ((lseek(trace_fd, 0, SEEK_SET) == 0) && (ftruncate(trace_fd, 0) == 0))
+	{
+		(void)gb_dbg_write_trace(p_traced_gb, trace_fd);
+	}
+
+	(void)signal(sig, SIG_DFL);
+	(void)raise(sig);
+}
+
+/* Options follow the boot ROM and ROM paths. */
+static int main_option(int argc, char *argv[], const char *option)
+{
+	for (int i = 3; i < argc; i++)
+	{
+		if (!strcmp(argv[i], option))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Value following an option, NULL when absent. */
+static const char *main_option_value(int argc, char *argv[], const char *option)
+{
+	for (int i = 3; i < (argc - 1); i++)
+	{
+		if (!strcmp(argv[i], option))
+			return argv[i + 1];
+	}
+
+	return NULL;
+}
 
 int main(int argc, char *argv[])
 {
@@ -14,8 +65,6 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	gb_init();
-
 	gb_t *p_gb = gb_allocate();
 	if (!p_gb)
 	{
@@ -23,6 +72,58 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+#ifdef CPU_JIT
+	/* Option "--jit-diff" checks the JIT against the interpreter. */
+	gb_jit_mode_t jit_mode = main_option(argc, argv, "--jit-diff") ? GB_JIT_DIFF : GB_JIT_ON;
+	if (0 != gb_set_jit(p_gb, jit_mode))
+	{
+		printf("gb_set_jit failed.\n");
+	}
+#endif
+
+	/* Option "--trace" records the last instructions, dumped with T, on errors
+	and crashes. */
+	if (main_option(argc, argv, "--trace"))
+	{
+		if (0 != gb_dbg_set_trace(p_gb, 1))
+		{
+			printf("gb_dbg_set_trace failed.\n");
+		}
+		else
+		{
+			p_traced_gb = p_gb;
+
+			trace_fd = open(TRACE_PATH, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+			if (trace_fd < 0)
+			{
+				printf("Failed to open file: %s, no dump on crashes.\n", TRACE_PATH);
+			}
+			else
+			{
+				(void)signal(SIGSEGV, main_crash);
+				(void)signal(SIGFPE, main_crash);
+				(void)signal(SIGILL, main_crash);
+				(void)signal(SIGABRT, main_crash);
+			}
+		}
+	}
+
+	/* Option "--profile" samples the pc, reported at exit per function of the
+	symbol file given with "--sym <file>". */
+	if (main_option(argc, argv, "--profile"))
+	{
+		const char *sym = main_option_value(argc, argv, "--sym");
+
+		if (0 != gb_dbg_set_sampler(p_gb, CPU_SAMPLER_PERIOD))
+		{
+			printf("gb_dbg_set_sampler failed.\n");
+		}
+		else if (sym && (0 != gb_dbg_load_symbols(p_gb, sym)))
+		{
+			printf("gb_dbg_load_symbols failed.\n");
+		}
+	}
+
 	if (0 != gb_load_program(p_gb, argv[1], argv[2]))
 	{
 		printf("mmu_load_boot failed.\n");
@@ -49,7 +150,11 @@ int main(int argc, char *argv[])
 	{
 		unsigned int time_start = SDL_GetTicks();
 
-		(void)gb_execute(p_gb, 1000.0 / 60.0);
+		if (0 != gb_execute(p_gb, 1000.0 / 60.0))
+		{
+			(void)gb_dbg_dump_trace(p_traced_gb, TRACE_PATH);
+			quit = 1;
+		}
 
 		unsigned int delta_gb = SDL_GetTicks() - time_start;
 
@@ -79,6 +184,10 @@ int main(int argc, char *argv[])
 					regs = ((regs - 1) + DBG_REGISTERS_MAX) % DBG_REGISTERS_MAX;
 					break;
 
+				case SDL_SCANCODE_T:
+					(void)gb_dbg_dump_trace(p_traced_gb, TRACE_PATH);
+					break;
+
 				default:
 					break;
 				}
@@ -108,11 +217,27 @@ int main(int argc, char *argv[])
 		}
 	}
 
+#ifdef MMU_PROFILE
+	(void)gb_dbg_dump_profile(p_gb, "mmu_profile.csv");
+#endif
+
+#ifdef CPU_STATS
+	gb_dbg_report_stats(p_gb);
+#endif
+
+	gb_dbg_report_samples(p_gb);
+
 	display_free(p_display);
 	p_display = NULL;
 
 	display_quit();
 
+	p_traced_gb = NULL;
+	if (trace_fd >= 0)
+	{
+		(void)close(trace_fd);
+		trace_fd = -1;
+	}
 	gb_free(p_gb);
 	p_gb = NULL;
 
@@ -0,0 +1,259 @@
+#include "cpu_trace.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Offline decoder for CPU trace dumps (see gb/cpu/cpu_trace.h).
+Usage: gbtrace <trace> [count], prints the last count instructions, all by
+default, one per line: clock, bank:pc, bytes, disassembly, then the registers
+before the instruction. */
+
+static const char *const str_r8[8] = {"B", "C", "D", "E", "H", "L", "(HL)", "A"};
+static const char *const str_r16[4] = {"BC", "DE", "HL", "SP"};
+static const char *const str_r16_af[4] = {"BC", "DE", "HL", "AF"};
+static const char *const str_cc[4] = {"NZ", "Z", "NC", "C"};
+static const char *const str_alu[8] = {"ADD A,", "ADC A,", "SUB", "SBC A,", "AND", "XOR", "OR", "CP"};
+static const char *const str_rot[8] = {"RLC", "RRC", "RL", "RR", "SLA", "SRA", "SWAP", "SRL"};
+static const char *const str_bit[4] = {"", "BIT", "RES", "SET"};
+static const char *const str_misc[8] = {"RLCA", "RRCA", "RLA", "RRA", "DAA", "CPL", "SCF", "CCF"};
+static const char *const str_ld_a[8] = {"LD (BC), A", "LD A, (BC)", "LD (DE), A", "LD A, (DE)",
+										"LD (HL+), A", "LD A, (HL+)", "LD (HL-), A", "LD A, (HL-)"};
+
+/* Same lengths as the emulator, STOP included (1 byte). */
+static int gbtrace_length(uint8_t opcode)
+{
+	switch (opcode)
+	{
+	case 0x01: case 0x08: case 0x11: case 0x21: case 0x31:
+	case 0xC2: case 0xC3: case 0xC4: case 0xCA: case 0xCC: case 0xCD:
+	case 0xD2: case 0xD4: case 0xDA: case 0xDC: case 0xEA: case 0xFA:
+		return 3;
+
+	case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x36: case 0x3E:
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+	case 0xE0: case 0xE8: case 0xF0: case 0xF8: case 0xCB:
+		return 2;
+
+	default:
+		return 1;
+	}
+}
+
+static void gbtrace_disassemble(const uint8_t *bytes, uint16_t pc, char *str, size_t size)
+{
+	uint8_t opcode = bytes[0];
+	uint8_t n = bytes[1];
+	uint16_t nn = (uint16_t)(bytes[1] | (bytes[2] << 8));
+	uint16_t target = (uint16_t)(pc + 2 + (int8_t)n);
+
+	int x = opcode >> 6;
+	int y = (opcode >> 3) & 7;
+	int z = opcode & 7;
+	int p = y >> 1;
+	int q = y & 1;
+
+	if (x == 0)
+	{
+		switch (z)
+		{
+		case 0:
+			if (y == 0)
+				(void)snprintf(str, size, "NOP");
+			else if (y == 1)
+				(void)snprintf(str, size, "LD (%04X), SP", nn);
+			else if (y == 2)
+				(void)snprintf(str, size, "STOP");
+			else if (y == 3)
+				(void)snprintf(str, size, "JR %04X", target);
+			else
+				(void)snprintf(str, size, "JR %s, %04X", str_cc[y - 4], target);
+			break;
+		case 1:
+			if (q)
+				(void)snprintf(str, size, "ADD HL, %s", str_r16[p]);
+			else
+				(void)snprintf(str, size, "LD %s, %04X", str_r16[p], nn);
+			break;
+		case 2:
+			(void)snprintf(str, size, "%s", str_ld_a[y]);
+			break;
+		case 3:
+			(void)snprintf(str, size, "%s %s", q ? "DEC" : "INC", str_r16[p]);
+			break;
+		case 4:
+		case 5:
+			(void)snprintf(str, size, "%s %s", (z == 4) ? "INC" : "DEC", str_r8[y]);
+			break;
+		case 6:
+			(void)snprintf(str, size, "LD %s, %02X", str_r8[y], n);
+			break;
+		default:
+			(void)snprintf(str, size, "%s", str_misc[y]);
+			break;
+		}
+	}
+	else if (x == 1)
+	{
+		if (opcode == 0x76)
+			(void)snprintf(str, size, "HALT");
+		else
+			(void)snprintf(str, size, "LD %s, %s", str_r8[y], str_r8[z]);
+	}
+	else if (x == 2)
+	{
+		(void)snprintf(str, size, "%s %s", str_alu[y], str_r8[z]);
+	}
+	else
+	{
+		switch (z)
+		{
+		case 0:
+			if (y < 4)
+				(void)snprintf(str, size, "RET %s", str_cc[y]);
+			else if (y == 4)
+				(void)snprintf(str, size, "LD (FF00+%02X), A", n);
+			else if (y == 5)
+				(void)snprintf(str, size, "ADD SP, %d", (int8_t)n);
+			else if (y == 6)
+				(void)snprintf(str, size, "LD A, (FF00+%02X)", n);
+			else
+				(void)snprintf(str, size, "LD HL, SP%+d", (int8_t)n);
+			break;
+		case 1:
+			if (!q)
+				(void)snprintf(str, size, "POP %s", str_r16_af[p]);
+			else
+				(void)snprintf(str, size, "%s", (const char *const[]){"RET", "RETI", "JP HL", "LD SP, HL"}[p]);
+			break;
+		case 2:
+			if (y < 4)
+				(void)snprintf(str, size, "JP %s, %04X", str_cc[y], nn);
+			else if (y == 4)
+				(void)snprintf(str, size, "LD (FF00+C), A");
+			else if (y == 5)
+				(void)snprintf(str, size, "LD (%04X), A", nn);
+			else if (y == 6)
+				(void)snprintf(str, size, "LD A, (FF00+C)");
+			else
+				(void)snprintf(str, size, "LD A, (%04X)", nn);
+			break;
+		case 3:
+			if (y == 0)
+				(void)snprintf(str, size, "JP %04X", nn);
+			else if ((y == 1) && (n >> 6))
+				(void)snprintf(str, size, "%s %d, %s", str_bit[n >> 6], (n >> 3) & 7, str_r8[n & 7]);
+			else if (y == 1)
+				(void)snprintf(str, size, "%s %s", str_rot[(n >> 3) & 7], str_r8[n & 7]);
+			else if (y == 6)
+				(void)snprintf(str, size, "DI");
+			else if (y == 7)
+				(void)snprintf(str, size, "EI");
+			else
+				(void)snprintf(str, size, "DB %02X", opcode);
+			break;
+		case 4:
+			if (y < 4)
+				(void)snprintf(str, size, "CALL %s, %04X", str_cc[y], nn);
+			else
+				(void)snprintf(str, size, "DB %02X", opcode);
+			break;
+		case 5:
+			if (!q)
+				(void)snprintf(str, size, "PUSH %s", str_r16_af[p]);
+			else if (p == 0)
+				(void)snprintf(str, size, "CALL %04X", nn);
+			else
+				(void)snprintf(str, size, "DB %02X", opcode);
+			break;
+		case 6:
+			(void)snprintf(str, size, "%s %02X", str_alu[y], n);
+			break;
+		default:
+			(void)snprintf(str, size, "RST %02X", y * 8);
+			break;
+		}
+	}
+}
+
+static void gbtrace_print(const cpu_trace_entry_t *p_entry)
+{
+	char bytes[12] = "";
+	char instruction[24] = "???";
+
+	for (int i = 0; i < p_entry->size; i++)
+	{
+		(void)snprintf(bytes + (3 * i), sizeof(bytes) - (3 * i), "%02X ", p_entry->bytes[i]);
+	}
+
+	if (p_entry->size && (p_entry->size >= gbtrace_length(p_entry->bytes[0])))
+	{
+		gbtrace_disassemble(p_entry->bytes, p_entry->pc, instruction, sizeof(instruction));
+	}
+
+	printf("%12llu %03X:%04X  %-9s %-18s AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X%s\n", (unsigned long long)p_entry->clock,
+		   p_entry->bank, p_entry->pc, bytes, instruction, p_entry->af, p_entry->bc, p_entry->de, p_entry->hl, p_entry->sp,
+		   (p_entry->flags & CPU_TRACE_IME) ? " IME" : "");
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: gbtrace <trace> [count]\n");
+		return -1;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	if (!file)
+	{
+		printf("Failed to open file: %s\n", argv[1]);
+		return -1;
+	}
+
+	char magic[4];
+	uint32_t header[2];
+
+	if ((1 != fread(magic, sizeof(magic), 1, file)) || (1 != fread(header, sizeof(header), 1, file)) ||
+		memcmp(magic, "GBTR", 4) || (header[0] != CPU_TRACE_VERSION))
+	{
+		printf("Not a CPU trace: %s\n", argv[1]);
+		(void)fclose(file);
+		return -1;
+	}
+
+	uint32_t count = header[1];
+	uint32_t skip = 0;
+
+	if (argc > 2)
+	{
+		uint32_t last = (uint32_t)strtoul(argv[2], NULL, 0);
+		if (last < count)
+		{
+			skip = count - last;
+		}
+	}
+
+	int ret = 0;
+	cpu_trace_entry_t entry;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (1 != fread(&entry, sizeof(entry), 1, file))
+		{
+			printf("Truncated CPU trace: %s\n", argv[1]);
+			ret = -1;
+			break;
+		}
+
+		if (i >= skip)
+		{
+			gbtrace_print(&entry);
+		}
+	}
+
+	(void)fclose(file);
+
+	return ret;
+}